@@ -0,0 +1,131 @@
+#include "benchmark.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QRandomGenerator>
+#include <QResizeEvent>
+#include <QThread>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+Benchmark::Benchmark(const QString& lab, int argc, char *argv[])
+    : m_lab(lab)
+    , m_frames(100)
+    , m_viewports({ QSize(640, 480), QSize(1280, 720), QSize(1920, 1080), QSize(3840, 2160) })
+{
+    // Only the number of frames can be changed: --frames N
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--frames") == 0) {
+            m_frames = std::max(1, std::atoi(argv[i + 1]));
+        }
+    }
+}
+
+void Benchmark::useOffscreenPlatform() {
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+}
+
+void Benchmark::resizeWidget(QWidget& widget, const QSize& size) {
+    QSize oldSize = widget.size();
+    widget.resize(size);
+
+    // Hidden widgets only get their resize event when shown, which never happens here
+    QResizeEvent event(size, oldSize);
+    QCoreApplication::sendEvent(&widget, &event);
+}
+
+const QList<QSize>& Benchmark::viewports() const {
+    return m_viewports;
+}
+
+QList<int> Benchmark::threadCounts() {
+    int cores = std::max(1, QThread::idealThreadCount());
+
+    QList<int> counts;
+    for (int threads = 1; threads < cores; threads *= 2) {
+        counts.append(threads);
+    }
+    counts.append(cores);
+
+    return counts;
+}
+
+QImage Benchmark::testImage(const QSize& size) {
+    QImage image(size, QImage::Format_ARGB32);
+    QRandomGenerator random(42);
+
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb* row = reinterpret_cast<QRgb*>(image.scanLine(y));
+
+        for (int x = 0; x < image.width(); ++x) {
+            int noise = random.bounded(-32, 33);
+            row[x] = qRgb(std::clamp(x * 255 / image.width() + noise, 0, 255),
+                          std::clamp(y * 255 / image.height() + noise, 0, 255),
+                          std::clamp((x + y) % 256 + noise, 0, 255));
+        }
+    }
+
+    return image;
+}
+
+void Benchmark::measure(const QString& stage, const QSize& viewport, const QJsonObject& parameters,
+                        qint64 triangles, const std::function<void()>& frame)
+{
+    double nsPerFrame = time(frame);
+    double framesPerSecond = 1e9 / nsPerFrame;
+
+    record(stage, viewport, nsPerFrame, {
+        { "parameters", parameters },
+        { "triangles", triangles },
+        { "trianglesPerSecond", triangles * framesPerSecond }
+    });
+}
+
+void Benchmark::measure(const QString& stage, const QSize& viewport, const QJsonObject& parameters,
+                        const std::function<void()>& frame)
+{
+    record(stage, viewport, time(frame), {
+        { "parameters", parameters }
+    });
+}
+
+double Benchmark::time(const std::function<void()>& frame) const {
+    frame(); // Warm-up: caches, lazily allocated buffers, thread pool start
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < m_frames; ++i) {
+        frame();
+    }
+
+    return double(timer.nsecsElapsed()) / m_frames;
+}
+
+void Benchmark::record(const QString& stage, const QSize& viewport, double nsPerFrame, QJsonObject result) {
+    double framesPerSecond = 1e9 / nsPerFrame;
+
+    result.insert("stage", stage);
+    result.insert("viewport", QJsonArray{ viewport.width(), viewport.height() });
+    result.insert("nsPerFrame", nsPerFrame);
+    result.insert("pixelsPerSecond", double(viewport.width()) * viewport.height() * framesPerSecond);
+    m_results.append(result);
+
+    std::fprintf(stderr, "%s %s %dx%d: %.0f ns/frame\n", qPrintable(m_lab), qPrintable(stage),
+                 viewport.width(), viewport.height(), nsPerFrame);
+}
+
+void Benchmark::report() const {
+    QJsonObject root = {
+        { "lab", m_lab },
+        { "frames", m_frames },
+        { "results", m_results }
+    };
+
+    std::fputs(QJsonDocument(root).toJson(QJsonDocument::Indented).constData(), stdout);
+}
@@ -0,0 +1,52 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QSize>
+#include <QString>
+#include <QWidget>
+
+#include <functional>
+
+// Times rendering stages or image filters of a lab and collects the results as JSON
+class Benchmark
+{
+public:
+    Benchmark(const QString& lab, int argc, char *argv[]);
+
+    // Must be called before QApplication is constructed
+    static void useOffscreenPlatform();
+    // Resize a widget that is never shown and deliver the resize event right away
+    static void resizeWidget(QWidget& widget, const QSize& size);
+
+    // Viewport sizes every lab is measured at
+    const QList<QSize>& viewports() const;
+    // Thread counts filters are measured with: powers of two up to the number of cores
+    static QList<int> threadCounts();
+    // Noisy color image with smooth gradients, the input of the filter benchmarks
+    static QImage testImage(const QSize& size);
+
+    // Run `frame` once to warm up, then time it over the configured number of frames
+    void measure(const QString& stage, const QSize& viewport, const QJsonObject& parameters,
+                 qint64 triangles, const std::function<void()>& frame);
+    // Same, for stages that process an image of the viewport size rather than triangles
+    void measure(const QString& stage, const QSize& viewport, const QJsonObject& parameters,
+                 const std::function<void()>& frame);
+    // Print every measurement to stdout
+    void report() const;
+
+private:
+    // Time `frame` and return the average nanoseconds per frame
+    double time(const std::function<void()>& frame) const;
+    void record(const QString& stage, const QSize& viewport, double nsPerFrame, QJsonObject result);
+
+    QString m_lab;           // Name of the lab being measured
+    int m_frames;            // Timed frames per measurement
+    QList<QSize> m_viewports;
+    QJsonArray m_results;
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,42 @@
+#include "benchmark.h"
+#include "scene.h"
+
+#include <QApplication>
+#include <QImage>
+
+// Lab-1 draws the wireframe straight from paintEvent, so the whole widget is rendered
+class SceneBenchmark
+{
+public:
+    static void run(Benchmark& benchmark) {
+        Scene scene;
+        const Object* object = scene.getObject();
+
+        QJsonObject parameters = {
+            { "vertices", object->getVertices().size() },
+            { "edges", object->getEdges().size() }
+        };
+
+        for (const QSize& viewport : benchmark.viewports()) {
+            Benchmark::resizeWidget(scene, viewport);
+            QImage image(viewport, QImage::Format_ARGB32_Premultiplied);
+
+            // Wireframe only, there are no triangles to count
+            benchmark.measure("paintEvent", viewport, parameters, 0, [&] {
+                scene.render(&image);
+            });
+        }
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    Benchmark::useOffscreenPlatform();
+    QApplication a(argc, argv);
+
+    Benchmark benchmark("lab-1", argc, argv);
+    SceneBenchmark::run(benchmark);
+    benchmark.report();
+
+    return 0;
+}
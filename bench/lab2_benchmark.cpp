@@ -0,0 +1,54 @@
+#include "benchmark.h"
+#include "scene.h"
+
+#include <QApplication>
+#include <QImage>
+#include <QPainter>
+
+class SceneBenchmark
+{
+public:
+    static void run(Benchmark& benchmark) {
+        Scene scene;
+        const Object* object = scene.getObject();
+        const qint64 faces = object->getFaces().size();
+
+        const QList<QPair<Scene::RenderMode, QString>> modes = {
+            { Scene::RenderMode::NoCulling, "noCulling" },
+            { Scene::RenderMode::BackfaceCulling, "backfaceCulling" },
+            { Scene::RenderMode::Visualization, "visualization" }
+        };
+
+        for (const QSize& viewport : benchmark.viewports()) {
+            Benchmark::resizeWidget(scene, viewport);
+            QImage image(viewport, QImage::Format_ARGB32_Premultiplied);
+
+            for (const auto& [mode, name] : modes) {
+                scene.setRenderMode(mode);
+
+                QJsonObject parameters = {
+                    { "vertices", object->getVertices().size() },
+                    { "renderMode", name }
+                };
+
+                benchmark.measure("renderFaces", viewport, parameters, faces, [&] {
+                    QPainter painter(&image);
+                    painter.setRenderHint(QPainter::Antialiasing);
+                    scene.renderFaces(painter);
+                });
+            }
+        }
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    Benchmark::useOffscreenPlatform();
+    QApplication a(argc, argv);
+
+    Benchmark benchmark("lab-2", argc, argv);
+    SceneBenchmark::run(benchmark);
+    benchmark.report();
+
+    return 0;
+}
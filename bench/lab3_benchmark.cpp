@@ -0,0 +1,118 @@
+#include "benchmark.h"
+#include "rasterizer.h"
+#include "scene.h"
+
+#include <QApplication>
+#include <QImage>
+#include <QPainter>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+class SceneBenchmark
+{
+public:
+    static void run(Benchmark& benchmark) {
+        Scene scene;
+        Object* object = scene.getObject();
+
+        // Number of subdivisions around the Y-axis, i.e. the mesh size
+        const QList<int> resolutions = { 16, 64, 180, 720 };
+
+        const QList<QPair<Scene::LightingMode, QString>> modes = {
+            { Scene::LightingMode::Simple, "simple" },
+            { Scene::LightingMode::GouraudShading, "gouraud" }
+        };
+
+        for (const QSize& viewport : benchmark.viewports()) {
+            Benchmark::resizeWidget(scene, viewport);
+            QImage image(viewport, QImage::Format_ARGB32_Premultiplied);
+
+            for (int resolution : resolutions) {
+                object->setResolution(resolution);
+                const qint64 triangles = object->getTriangles().size();
+
+                for (const auto& [mode, name] : modes) {
+                    scene.setLightingModel(mode);
+
+                    QJsonObject parameters = {
+                        { "resolution", resolution },
+                        { "vertices", object->getVertices().size() },
+                        { "lighting", name }
+                    };
+
+                    QMatrix4x4 model = scene.m_object->getModelMatrix();
+                    QMatrix4x4 view = scene.m_camera->getViewMatrix();
+
+                    benchmark.measure("transformVertices", viewport, parameters, triangles, [&] {
+                        scene.transformVertices(model, view);
+                    });
+
+                    benchmark.measure("renderTriangles", viewport, parameters, triangles, [&] {
+                        QPainter painter(&image);
+                        painter.setRenderHint(QPainter::Antialiasing);
+                        scene.renderTriangles(painter);
+                    });
+                }
+            }
+        }
+    }
+};
+
+// Fill rate of the rasterizer alone, on one triangle covering half of the viewport
+class RasterizerBenchmark
+{
+public:
+    static void run(Benchmark& benchmark) {
+        const QList<QPair<Rasterizer::Pass, QString>> passes = {
+            { Rasterizer::Pass::DepthAndColor, "depth-and-color" },
+            { Rasterizer::Pass::DepthOnly, "depth-only" }
+        };
+
+        for (const QSize& viewport : benchmark.viewports()) {
+            int width = viewport.width();
+            int height = viewport.height();
+
+            QImage image(viewport, QImage::Format_ARGB32_Premultiplied);
+            std::vector<float> depth(size_t(width) * height);
+            Rasterizer::FrameBufferView target = {
+                reinterpret_cast<QRgb*>(image.bits()), image.bytesPerLine() / qsizetype(sizeof(QRgb)),
+                depth.data(), width, height
+            };
+
+            // Vertices off the pixel grid, so that edges and attributes step through fractions
+            Rasterizer::ShadedTriangle triangle = {
+                QPointF(0.3, 0.2), QPointF(width - 0.7, 0.6), QPointF(0.4, height - 0.3),
+                0.1f, 0.9f, 0.5f,
+                0.2f, 0.8f, 0.5f
+            };
+
+            for (const auto& [pass, name] : passes) {
+                QJsonObject parameters = {
+                    { "pass", name },
+                    { "pixels", qint64(width) * height / 2 }
+                };
+
+                // The depth buffer is cleared every frame, or every pixel after the first would fail the test
+                benchmark.measure("fillTriangle (large)", viewport, parameters, 1, [&] {
+                    std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+                    Rasterizer::fillTriangle(target, triangle, 0, height - 1, pass);
+                });
+            }
+        }
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    Benchmark::useOffscreenPlatform();
+    QApplication a(argc, argv);
+
+    Benchmark benchmark("lab-3", argc, argv);
+    SceneBenchmark::run(benchmark);
+    RasterizerBenchmark::run(benchmark);
+    benchmark.report();
+
+    return 0;
+}
@@ -0,0 +1,35 @@
+#include "benchmark.h"
+#include "imageprocessor.h"
+
+#include <QApplication>
+#include <QThreadPool>
+
+int main(int argc, char *argv[])
+{
+    Benchmark::useOffscreenPlatform();
+    QApplication a(argc, argv);
+
+    Benchmark benchmark("lab-5", argc, argv);
+    QThreadPool* pool = QThreadPool::globalInstance();
+
+    for (const QSize& viewport : benchmark.viewports()) {
+        QImage image = Benchmark::testImage(viewport);
+
+        for (int threads : Benchmark::threadCounts()) {
+            pool->setMaxThreadCount(threads);
+            QJsonObject parameters = { { "threads", threads } };
+
+            benchmark.measure("applyTransformations", viewport, parameters, [&] {
+                ImageProcessor::applyTransformations(image, 20, 7000, true, true);
+            });
+
+            benchmark.measure("binarizeAdaptive", viewport, parameters, [&] {
+                ImageProcessor::binarizeAdaptive(image);
+            });
+        }
+    }
+
+    benchmark.report();
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "benchmark.h"
+#include "displacementfield.h"
+#include "imageprocessor.h"
+
+#include <QApplication>
+#include <QThreadPool>
+
+int main(int argc, char *argv[])
+{
+    Benchmark::useOffscreenPlatform();
+    QApplication a(argc, argv);
+
+    Benchmark benchmark("lab-6", argc, argv);
+    QThreadPool* pool = QThreadPool::globalInstance();
+
+    for (const QSize& viewport : benchmark.viewports()) {
+        QImage image = Benchmark::testImage(viewport);
+        DisplacementField swirl = DisplacementField::swirl(viewport, 3.0f);
+
+        for (int threads : Benchmark::threadCounts()) {
+            pool->setMaxThreadCount(threads);
+            QJsonObject parameters = { { "threads", threads } };
+
+            // Convolution: dense symmetric 3x3, unrolled
+            benchmark.measure("applyBasicSharpeningFilter", viewport, parameters, [&] {
+                ImageProcessor::applyBasicSharpeningFilter(image, 3);
+            });
+
+            // Convolution: sparse 3x3, zero taps skipped
+            benchmark.measure("applyLaplacian", viewport, parameters, [&] {
+                ImageProcessor::applyLaplacian(image, 3);
+            });
+
+            // Fused gradient: luminance, Sobel magnitude and blend in one pass
+            benchmark.measure("applySobelFilter", viewport, parameters, [&] {
+                ImageProcessor::applySobelFilter(image, 3);
+            });
+
+            // Canny: blur, gradient and non-maximum suppression in row bands, then hysteresis
+            benchmark.measure("applyCannyFilter", viewport, parameters, [&] {
+                ImageProcessor::applyCannyFilter(image, 1.4, 50, 150);
+            });
+
+            // Counter-based RNG: per-pixel draws in row bands
+            benchmark.measure("applyGaussianNoise", viewport, parameters, [&] {
+                ImageProcessor::applyGaussianNoise(image, 10.0, 1);
+            });
+
+            // Displacement: field generated and applied
+            benchmark.measure("applyGlassEffect", viewport, parameters, [&] {
+                ImageProcessor::applyGlassEffect(image, 3, 1);
+            });
+
+            // Displacement: bilinear warp through a field generated beforehand
+            benchmark.measure("DisplacementField::apply (swirl)", viewport, parameters, [&] {
+                swirl.apply(image);
+            });
+        }
+    }
+
+    benchmark.report();
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "benchmark.h"
+#include "imageprocessor.h"
+#include "imagepyramid.h"
+
+#include <QApplication>
+#include <QThreadPool>
+
+int main(int argc, char *argv[])
+{
+    Benchmark::useOffscreenPlatform();
+    QApplication a(argc, argv);
+
+    Benchmark benchmark("lab-7", argc, argv);
+    QThreadPool* pool = QThreadPool::globalInstance();
+
+    // Downscaling and upscaling of the viewport-sized image
+    const QList<float> scales = { 0.5f, 2.0f };
+    const QList<float> zoomOutScales = { 0.3f, 0.1f };
+
+    const QList<QPair<ImageProcessor::ScalingPath, QString>> paths = {
+        { ImageProcessor::ScalingPath::Simd, "simd" },
+        { ImageProcessor::ScalingPath::Reference, "reference" }
+    };
+
+    const QList<QPair<ImageProcessor::ResamplingFilter, QString>> filters = {
+        { ImageProcessor::ResamplingFilter::Area, "area" },
+        { ImageProcessor::ResamplingFilter::CatmullRom, "catmull-rom" },
+        { ImageProcessor::ResamplingFilter::Mitchell, "mitchell" },
+        { ImageProcessor::ResamplingFilter::Lanczos3, "lanczos3" }
+    };
+
+    for (const QSize& viewport : benchmark.viewports()) {
+        QImage image = Benchmark::testImage(viewport);
+
+        for (int threads : Benchmark::threadCounts()) {
+            pool->setMaxThreadCount(threads);
+
+            for (float scale : scales) {
+                for (const auto& [path, name] : paths) {
+                    QJsonObject parameters = { { "threads", threads }, { "scale", scale }, { "path", name } };
+
+                    benchmark.measure("applyNearestNeighbourScaling", viewport, parameters, [&] {
+                        ImageProcessor::applyNearestNeighbourScaling(image, scale, path);
+                    });
+
+                    benchmark.measure("applyBilinearScaling", viewport, parameters, [&] {
+                        ImageProcessor::applyBilinearScaling(image, scale, path);
+                    });
+                }
+
+                for (const auto& [filter, name] : filters) {
+                    QJsonObject parameters = { { "threads", threads }, { "scale", scale }, { "filter", name } };
+
+                    benchmark.measure("applyResampling", viewport, parameters, [&] {
+                        ImageProcessor::applyResampling(image, scale, filter);
+                    });
+                }
+            }
+
+            // Zoom-out served from an already built pyramid, as in MainWindow::scaleImage
+            ImagePyramid pyramid;
+            pyramid.setSource(image);
+
+            for (float scale : zoomOutScales) {
+                QSize size = ImageProcessor::scaledSize(image, scale);
+                pyramid.levelFor(size);
+
+                QJsonObject parameters = { { "threads", threads }, { "scale", scale }, { "filter", "area" } };
+
+                benchmark.measure("applyResampling (pyramid)", viewport, parameters, [&] {
+                    ImageProcessor::applyResampling(pyramid.levelFor(size), size, ImageProcessor::ResamplingFilter::Area);
+                });
+
+                benchmark.measure("applyResampling (source)", viewport, parameters, [&] {
+                    ImageProcessor::applyResampling(image, size, ImageProcessor::ResamplingFilter::Area);
+                });
+            }
+        }
+    }
+
+    benchmark.report();
+
+    return 0;
+}
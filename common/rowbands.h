@@ -0,0 +1,81 @@
+#ifndef ROWBANDS_H
+#define ROWBANDS_H
+
+#include <QSemaphore>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+// Runs a per-row image filter on the global thread pool, one horizontal band at a time.
+// A band is sized so that the source rows it reads (its own rows plus `halo` rows above and
+// below for convolutions) and the rows it writes stay in a core's cache. Threads pick the next
+// unprocessed band as soon as they are done with one, so slow bands don't hold the others up.
+class RowBands
+{
+public:
+    // Call fn(yBegin, yEnd) for bands covering rows [0; height). Uses up to
+    // QThreadPool::globalInstance()->maxThreadCount() threads, the calling one included.
+    template <typename Fn>
+    static void run(int height, qsizetype bytesPerLine, int halo, Fn&& fn);
+    // Same, with bands of the given number of rows. For filters that stream their rows through
+    // small buffers of their own, where a band only has to be tall enough to amortize its halo.
+    template <typename Fn>
+    static void runRows(int height, int rows, Fn&& fn);
+
+    // Number of rows in a band of an image with the given row length
+    static int bandHeight(qsizetype bytesPerLine, int halo);
+
+private:
+    static constexpr qsizetype CACHE_BUDGET = 256 * 1024; // Bytes of source and destination rows per band
+};
+
+inline int RowBands::bandHeight(qsizetype bytesPerLine, int halo) {
+    // (rows + 2 * halo) source rows and rows destination rows
+    qsizetype rows = (CACHE_BUDGET / std::max<qsizetype>(bytesPerLine, 1) - 2 * qsizetype(halo)) / 2;
+    return int(std::max<qsizetype>(rows, 1));
+}
+
+template <typename Fn>
+void RowBands::run(int height, qsizetype bytesPerLine, int halo, Fn&& fn) {
+    runRows(height, bandHeight(bytesPerLine, halo), std::forward<Fn>(fn));
+}
+
+template <typename Fn>
+void RowBands::runRows(int height, int rows, Fn&& fn) {
+    if (height <= 0) return;
+
+    rows = std::max(rows, 1);
+    int bandCount = (height + rows - 1) / rows;
+
+    QThreadPool* pool = QThreadPool::globalInstance();
+    int threads = std::min(bandCount, pool->maxThreadCount());
+
+    if (threads <= 1) {
+        fn(0, height);
+        return;
+    }
+
+    std::atomic<int> nextBand(0);
+    auto work = [&]() {
+        for (int band = nextBand++; band < bandCount; band = nextBand++) {
+            int yBegin = band * rows;
+            fn(yBegin, std::min(yBegin + rows, height));
+        }
+    };
+
+    // The calling thread takes bands too, so a busy pool (e.g. a nested call
+    // from a pool thread) just means fewer helpers rather than a deadlock
+    QSemaphore finished;
+    int helpers = 0;
+    for (int i = 1; i < threads; ++i) {
+        if (!pool->tryStart([&]() { work(); finished.release(); })) break;
+        ++helpers;
+    }
+
+    work();
+    finished.acquire(helpers);
+}
+
+#endif // ROWBANDS_H
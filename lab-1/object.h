@@ -67,7 +67,11 @@ private:
     QMatrix4x4 centeringMatrix() const;
 
 private:
+#ifdef LAB_DATA_PATH
+    const QString filepath = LAB_DATA_PATH; // Set by the build (e.g. the headless benchmarks)
+#else
     const QString filepath = "/home/kava/coding/cpp/computer-graphics/lab-1/data.csv"; // Hardcoded
+#endif
     QList<QVector3D> m_vertices; // Coordinates of a vertices
     QList<QPair<int32_t, int32_t>> m_edges; // Indices of vertices that are connected
 
@@ -15,6 +15,7 @@
 class Scene : public QWidget
 {
     Q_OBJECT
+
 public:
     explicit Scene(QWidget *parent = nullptr);
     virtual ~Scene();
@@ -67,7 +67,11 @@ private:
     QMatrix4x4 centeringMatrix() const;
 
 private:
+#ifdef LAB_DATA_PATH
+    const QString filepath = LAB_DATA_PATH; // Set by the build (e.g. the headless benchmarks)
+#else
     const QString filepath = "/home/kava/coding/cpp/computer-graphics/lab-2/data.csv"; // Hardcoded
+#endif
     QVector<QVector3D> m_vertices; // Coordinates of a vertices
     QVector<QVector<int32_t>> m_faces; // Indices of vertices that belong to the same surface
 
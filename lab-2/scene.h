@@ -15,6 +15,9 @@
 class Scene : public QWidget
 {
     Q_OBJECT
+    // Headless benchmark (bench/) drives the rendering stages directly
+    friend class SceneBenchmark;
+
 public:
     explicit Scene(QWidget *parent = nullptr);
     virtual ~Scene();
@@ -80,7 +80,11 @@ private:
     void centerVertices();
 
 private:
+#ifdef LAB_DATA_PATH
+    const QString filepath = LAB_DATA_PATH; // Set by the build (e.g. the headless benchmarks)
+#else
     const QString filepath = "/home/kava/coding/cpp/computer-graphics/lab-3/data.csv"; // Hardcoded
+#endif
 
     QVector<QPointF> m_curvePoints;     // 2D points defining the initial curve in xOY plane
     size_t m_curvePointsNumber;         // Number of curve points
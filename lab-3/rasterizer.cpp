@@ -0,0 +1,309 @@
+#include "rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+// The SSE2 span is always there on x86, the AVX2 one is picked at runtime when the CPU has it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RASTERIZER_SSE2
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define RASTERIZER_AVX2
+#define RASTERIZER_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(_MSC_VER)
+#define RASTERIZER_AVX2
+#define RASTERIZER_AVX2_TARGET
+#include <intrin.h>
+#endif
+#endif
+
+namespace {
+
+// Convert interpolated intensity into an opaque gray pixel
+inline QRgb shadePixel(float intensity) {
+    int val = int(std::clamp(intensity * 255.0f, 0.0f, 255.0f));
+    return qRgb(val, val, val);
+}
+
+// Depth test for a single fragment. Updates the depth buffer as the pass requires
+// and returns whether the fragment's color should be written.
+inline bool depthTest(Rasterizer::Pass pass, float z, float& stored) {
+    switch (pass) {
+    case Rasterizer::Pass::DepthAndColor:
+        if (!(z < stored)) return false; // Hidden behind an already drawn fragment
+        stored = z;
+        return true;
+    case Rasterizer::Pass::DepthOnly:
+        if (z < stored) stored = z;
+        return false;
+    case Rasterizer::Pass::ColorOnly:
+        return z == stored; // Only the closest fragment gets shaded
+    }
+    return false;
+}
+
+#if defined(RASTERIZER_AVX2)
+
+// Whether the CPU the program runs on has AVX2, whatever the build targets
+bool hasAvx2() {
+#if defined(__AVX2__)
+    return true;
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx2");
+#else
+    // AVX2 itself, and the OS saving the YMM registers on context switches
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5));
+#endif
+}
+
+// Fill pixels [x; xEnd] of a row that lies wholly inside the triangle, 8 at a time.
+// Returns the first pixel left for the scalar loop.
+RASTERIZER_AVX2_TARGET
+int fillSpanAvx2(QRgb* line, float* depthLine, int x, int xEnd, float fx, float rowI, float didx, float rowZ, float dzdx,
+                 Rasterizer::Pass pass)
+{
+    constexpr int LANES = 8;
+
+    // Pixel offsets from the bounding box origin, exact in float
+    __m256 offsets = _mm256_add_ps(_mm256_set1_ps(fx), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f));
+    const __m256 offsetsStep = _mm256_set1_ps(float(LANES));
+
+    const __m256 rowI8 = _mm256_set1_ps(rowI);
+    const __m256 didx8 = _mm256_set1_ps(didx);
+    const __m256 rowZ8 = _mm256_set1_ps(rowZ);
+    const __m256 dzdx8 = _mm256_set1_ps(dzdx);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 maxValue = _mm256_set1_ps(255.0f);
+    const __m256i alpha = _mm256_set1_epi32(int32_t(0xFF000000));
+
+    for (; x + LANES - 1 <= xEnd; x += LANES) {
+        __m256 z = _mm256_add_ps(rowZ8, _mm256_mul_ps(offsets, dzdx8));
+        __m256 stored = _mm256_loadu_ps(depthLine + x);
+        __m256 mask = (pass == Rasterizer::Pass::ColorOnly) ? _mm256_cmp_ps(z, stored, _CMP_EQ_OQ)
+                                                            : _mm256_cmp_ps(z, stored, _CMP_LT_OQ);
+        __m256 i = _mm256_add_ps(rowI8, _mm256_mul_ps(offsets, didx8));
+        offsets = _mm256_add_ps(offsets, offsetsStep);
+
+        if (_mm256_movemask_ps(mask) == 0) continue;
+
+        if (pass != Rasterizer::Pass::ColorOnly) {
+            _mm256_storeu_ps(depthLine + x, _mm256_blendv_ps(stored, z, mask));
+        }
+
+        __m256i val = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(i, maxValue), zero), maxValue));
+        __m256i rgb = _mm256_or_si256(_mm256_or_si256(alpha, val),
+                                      _mm256_or_si256(_mm256_slli_epi32(val, 8), _mm256_slli_epi32(val, 16)));
+
+        __m256i* dst = reinterpret_cast<__m256i*>(line + x);
+        __m256i old = _mm256_loadu_si256(dst);
+        _mm256_storeu_si256(dst, _mm256_blendv_epi8(old, rgb, _mm256_castps_si256(mask)));
+    }
+
+    return x;
+}
+
+#endif
+
+#if defined(RASTERIZER_SSE2)
+
+// Same, 4 pixels at a time
+int fillSpanSse2(QRgb* line, float* depthLine, int x, int xEnd, float fx, float rowI, float didx, float rowZ, float dzdx,
+                 Rasterizer::Pass pass)
+{
+    constexpr int LANES = 4;
+
+    // Pixel offsets from the bounding box origin, exact in float
+    __m128 offsets = _mm_add_ps(_mm_set1_ps(fx), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+    const __m128 offsetsStep = _mm_set1_ps(float(LANES));
+
+    const __m128 rowI4 = _mm_set1_ps(rowI);
+    const __m128 didx4 = _mm_set1_ps(didx);
+    const __m128 rowZ4 = _mm_set1_ps(rowZ);
+    const __m128 dzdx4 = _mm_set1_ps(dzdx);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 maxValue = _mm_set1_ps(255.0f);
+    const __m128i alpha = _mm_set1_epi32(int32_t(0xFF000000));
+
+    for (; x + LANES - 1 <= xEnd; x += LANES) {
+        __m128 z = _mm_add_ps(rowZ4, _mm_mul_ps(offsets, dzdx4));
+        __m128 stored = _mm_loadu_ps(depthLine + x);
+        __m128 mask = (pass == Rasterizer::Pass::ColorOnly) ? _mm_cmpeq_ps(z, stored) : _mm_cmplt_ps(z, stored);
+        __m128 i = _mm_add_ps(rowI4, _mm_mul_ps(offsets, didx4));
+        offsets = _mm_add_ps(offsets, offsetsStep);
+
+        if (_mm_movemask_ps(mask) == 0) continue;
+
+        if (pass != Rasterizer::Pass::ColorOnly) {
+            _mm_storeu_ps(depthLine + x, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, stored)));
+        }
+
+        __m128i val = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(i, maxValue), zero), maxValue));
+        __m128i rgb = _mm_or_si128(_mm_or_si128(alpha, val),
+                                   _mm_or_si128(_mm_slli_epi32(val, 8), _mm_slli_epi32(val, 16)));
+
+        __m128i maskBits = _mm_castps_si128(mask);
+        __m128i* dst = reinterpret_cast<__m128i*>(line + x);
+        __m128i old = _mm_loadu_si128(dst);
+        _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(maskBits, rgb), _mm_andnot_si128(maskBits, old)));
+    }
+
+    return x;
+}
+
+#endif
+
+// Fill the pixels of a row that lies wholly inside the triangle with the widest vector unit available.
+// Returns the first pixel left for the scalar loop.
+#if defined(RASTERIZER_SSE2)
+
+int fillSpanSimd(QRgb* line, float* depthLine, int x, int xEnd, float fx, float rowI, float didx, float rowZ, float dzdx,
+                 Rasterizer::Pass pass)
+{
+#if defined(RASTERIZER_AVX2)
+    static const bool avx2 = hasAvx2();
+    if (avx2) return fillSpanAvx2(line, depthLine, x, xEnd, fx, rowI, didx, rowZ, dzdx, pass);
+#endif
+    return fillSpanSse2(line, depthLine, x, xEnd, fx, rowI, didx, rowZ, dzdx, pass);
+}
+
+#else
+
+int fillSpanSimd(QRgb*, float*, int x, int, float, float, float, float, float, Rasterizer::Pass)
+{
+    // No vector unit available, everything goes through the scalar loop
+    return x;
+}
+
+#endif
+
+} // namespace
+
+void Rasterizer::fillTriangle(const FrameBufferView& target, const ShadedTriangle& triangle, int yMin, int yMax, Pass pass) {
+    const QPointF p[3] = { triangle.p0, triangle.p1, triangle.p2 };
+    float intensity[3] = { triangle.i0, triangle.i1, triangle.i2 };
+    float depth[3] = { triangle.z0, triangle.z1, triangle.z2 };
+
+    // Vertices that project() couldn't place on the screen end up far outside the guard band
+    for (const QPointF& v : p) {
+        if (std::abs(v.x()) > GUARD_BAND || std::abs(v.y()) > GUARD_BAND) return;
+    }
+
+    // Snap vertices to the subpixel grid
+    int64_t X[3], Y[3];
+    for (int k = 0; k < 3; ++k) {
+        X[k] = std::llround(p[k].x() * SUBPIXEL_ONE);
+        Y[k] = std::llround(p[k].y() * SUBPIXEL_ONE);
+    }
+
+    // Twice the signed area, make it positive so that inside means all edge functions >= 0
+    int64_t area = (X[1] - X[0]) * (Y[2] - Y[0]) - (Y[1] - Y[0]) * (X[2] - X[0]);
+    if (area == 0) return;
+    if (area < 0) {
+        std::swap(X[1], X[2]);
+        std::swap(Y[1], Y[2]);
+        std::swap(intensity[1], intensity[2]);
+        std::swap(depth[1], depth[2]);
+        area = -area;
+    }
+
+    // Bounding box clipped to the framebuffer. It's the origin for all incremental values,
+    // so it must not depend on [yMin; yMax] - otherwise tiles would round differently.
+    int minX = std::max(0, int(std::ceil(double(std::min({ X[0], X[1], X[2] })) / SUBPIXEL_ONE)));
+    int maxX = std::min(target.width - 1, int(std::floor(double(std::max({ X[0], X[1], X[2] })) / SUBPIXEL_ONE)));
+    int minY = std::max(0, int(std::ceil(double(std::min({ Y[0], Y[1], Y[2] })) / SUBPIXEL_ONE)));
+    int maxY = std::min(target.height - 1, int(std::floor(double(std::max({ Y[0], Y[1], Y[2] })) / SUBPIXEL_ONE)));
+
+    int rowStart = std::max(minY, yMin);
+    int rowEnd   = std::min(maxY, yMax);
+    if (minX > maxX || rowStart > rowEnd) return;
+
+    // Edge k is opposite to vertex k, so its function is the (unnormalized) barycentric weight of that vertex
+    Edge edges[3];
+    int64_t unbiased[3];
+    for (int k = 0; k < 3; ++k) {
+        int a = (k + 1) % 3;
+        int b = (k + 2) % 3;
+        int64_t dx = X[b] - X[a];
+        int64_t dy = Y[b] - Y[a];
+
+        unbiased[k] = dx * (int64_t(minY) * SUBPIXEL_ONE - Y[a]) - dy * (int64_t(minX) * SUBPIXEL_ONE - X[a]);
+
+        // Top-left rule: pixels exactly on an edge belong to only one of the two triangles sharing it
+        bool topLeft = dy < 0 || (dy == 0 && dx > 0);
+
+        edges[k].origin = unbiased[k] + (topLeft ? 0 : -1);
+        edges[k].stepX = -dy * SUBPIXEL_ONE;
+        edges[k].stepY = dx * SUBPIXEL_ONE;
+    }
+
+    // Plane equations of the interpolated attributes
+    auto setupPlane = [&](const float value[3]) {
+        double invArea = 1.0 / double(area);
+        double origin = 0.0, dx = 0.0, dy = 0.0;
+        for (int k = 0; k < 3; ++k) {
+            origin += double(unbiased[k]) * value[k];
+            dx += double(edges[k].stepX) * value[k];
+            dy += double(edges[k].stepY) * value[k];
+        }
+        return Plane{ float(origin * invArea), float(dx * invArea), float(dy * invArea) };
+    };
+
+    const Plane intensityPlane = setupPlane(intensity);
+    const Plane depthPlane = setupPlane(depth);
+
+    for (int y = rowStart; y <= rowEnd; ++y) {
+        int64_t rowOffset = y - minY;
+
+        // The pixels of a row inside all three edges are contiguous. Each edge with a non-zero step
+        // bounds them from one side, so the span comes straight from the edge values at its start.
+        int64_t first = 0;
+        int64_t last = maxX - minX;
+        for (const Edge& edge : edges) {
+            int64_t e = edge.origin + rowOffset * edge.stepY;
+            if (edge.stepX > 0) {
+                if (e < 0) first = std::max(first, (-e + edge.stepX - 1) / edge.stepX);
+            } else if (edge.stepX < 0) {
+                last = e < 0 ? -1 : std::min(last, e / -edge.stepX);
+            } else if (e < 0) {
+                last = -1;
+            }
+        }
+        if (first > last) continue;
+
+        float rowI = intensityPlane.origin + float(rowOffset) * intensityPlane.dy;
+        float rowZ = depthPlane.origin + float(rowOffset) * depthPlane.dy;
+
+        QRgb* line = target.pixels + y * target.stride;              // Raw pointer to a y-th framebuffer row
+        float* depthLine = target.depth + qsizetype(y) * target.width; // Raw pointer to a y-th depth buffer row
+
+        int x = minX + int(first);
+        int xEnd = minX + int(last);
+
+        // A plain minimum that the compiler vectorizes well on its own
+        if (pass == Pass::DepthOnly) {
+            for (; x <= xEnd; ++x) {
+                float z = rowZ + float(x - minX) * depthPlane.dx;
+                depthLine[x] = z < depthLine[x] ? z : depthLine[x];
+            }
+            continue;
+        }
+
+        x = fillSpanSimd(line, depthLine, x, xEnd, float(x - minX), rowI, intensityPlane.dx, rowZ, depthPlane.dx, pass);
+
+        // Scalar loop over whatever the vector path left
+        for (; x <= xEnd; ++x) {
+            float fx = float(x - minX);
+            float z = rowZ + fx * depthPlane.dx;
+
+            if (depthTest(pass, z, depthLine[x])) {
+                line[x] = shadePixel(rowI + fx * intensityPlane.dx);
+            }
+        }
+    }
+}
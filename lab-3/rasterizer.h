@@ -0,0 +1,60 @@
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include <QPointF>
+#include <QRgb>
+
+#include <cstdint>
+
+// Half-space (edge function) triangle rasterizer for the Gouraud framebuffer.
+// Vertices are snapped to a fixed-point subpixel grid and the edge functions give the exact
+// span of every row in integers. Spans are filled 8 (AVX2, picked at runtime) or 4 (SSE2)
+// pixels at a time with a scalar fallback for tails and other platforms.
+class Rasterizer
+{
+public:
+    // Triangle that has already been lit and projected, ready to be rasterized
+    struct ShadedTriangle {
+        QPointF p0, p1, p2; // Screen coordinates of the vertices
+        float i0, i1, i2;   // Light intensity at each vertex
+        float z0, z1, z2;   // Depth of each vertex
+    };
+
+    // Which buffers a rasterization pass tests against and writes to
+    enum class Pass {
+        DepthAndColor, // Depth test (less), writes depth and color
+        DepthOnly,     // Early-z pre-pass: depth test (less), writes depth only
+        ColorOnly      // Shading after the pre-pass: depth test (equal), writes color only
+    };
+
+    // Raw view of the framebuffer that rasterization threads write into
+    struct FrameBufferView {
+        QRgb* pixels;
+        qsizetype stride; // Row length in pixels
+        float* depth;     // Depth buffer, rows are exactly width floats long
+        int width, height;
+    };
+
+    // Fill the part of a triangle that lies within scanlines [yMin; yMax].
+    // Pixels are sampled at integer coordinates, shared edges follow the top-left rule.
+    static void fillTriangle(const FrameBufferView& target, const ShadedTriangle& triangle, int yMin, int yMax, Pass pass);
+
+private:
+    static constexpr int SUBPIXEL_BITS = 4;                 // Fixed-point precision of vertex positions
+    static constexpr int SUBPIXEL_ONE = 1 << SUBPIXEL_BITS; // One pixel in subpixel units
+    static constexpr float GUARD_BAND = 8192.0f;            // Triangles reaching past it are dropped
+
+    // Edge function E(x, y) of a single triangle edge, stepped per pixel
+    struct Edge {
+        int64_t origin;       // Value at the bounding box origin (bias included)
+        int64_t stepX, stepY; // Increments per pixel along X and Y
+    };
+
+    // Attribute interpolated linearly across the triangle
+    struct Plane {
+        float origin; // Value at the bounding box origin
+        float dx, dy; // Increments per pixel along X and Y
+    };
+};
+
+#endif // RASTERIZER_H
@@ -1,5 +1,8 @@
 #include "scene.h"
 #include <QDebug>
+#include <QtConcurrent>
+
+#include <limits>
 
 Scene::Scene(QWidget *parent)
     : QWidget{parent}
@@ -19,6 +22,11 @@ Scene::Scene(QWidget *parent)
     m_LightingMode = LightingMode::Simple;
     m_ambientIntensity = 0.1f;
 
+    m_transformedVertexCount = 0;
+
+    m_tiledRasterization = true;
+    m_earlyDepthTest = false;
+
     // Set scene's background color
     QPalette palette = this->palette();
     palette.setColor(QPalette::Window, QColor(240, 240, 240));
@@ -51,12 +59,51 @@ void Scene::paintEvent(QPaintEvent* event) {
     QMatrix4x4 model = m_object->getModelMatrix();
     QMatrix4x4 view = m_camera->getViewMatrix();
 
-    QMatrix4x4 modelView = view * model;
+    // Transform every vertex of the object exactly once for this frame
+    transformVertices(model, view);
 
     // Draw the axis
     renderAxis(painter, view);
     // Render triangulated object
-    renderTriangles(painter, modelView);
+    renderTriangles(painter);
+}
+
+void Scene::transformVertices(const QMatrix4x4& model, const QMatrix4x4& view) {
+    const QVector<QVector3D>& vertices = m_object->getVertices();
+    const QVector<QVector3D>& vertexNormals = m_object->getVertexNormals();
+    const qsizetype count = vertices.size();
+
+    QMatrix4x4 modelView = view * model;
+    QMatrix4x4 mvp = m_projectionMatrix * modelView;
+    QMatrix3x3 normalMatrix = model.normalMatrix();
+    bool gouraud = m_LightingMode == LightingMode::GouraudShading;
+
+    m_vertexCache.world.resize(count);
+    m_vertexCache.view.resize(count);
+    m_vertexCache.screen.resize(count);
+    m_vertexCache.depth.resize(count);
+    m_vertexCache.normals.resize(count);
+    m_vertexCache.intensity.resize(count);
+    m_transformedVertexCount = 0;
+
+    for (qsizetype k = 0; k < count; ++k) {
+        const QVector3D& v = vertices[k];
+        const QVector3D& n = vertexNormals[k];
+
+        m_vertexCache.world[k] = model.map(v);
+        m_vertexCache.view[k] = modelView.map(v);
+        m_vertexCache.screen[k] = projectToScreen(v, mvp, &m_vertexCache.depth[k]);
+        m_vertexCache.normals[k] = QVector3D(
+            normalMatrix(0,0) * n.x() + normalMatrix(0,1) * n.y() + normalMatrix(0,2) * n.z(),
+            normalMatrix(1,0) * n.x() + normalMatrix(1,1) * n.y() + normalMatrix(1,2) * n.z(),
+            normalMatrix(2,0) * n.x() + normalMatrix(2,1) * n.y() + normalMatrix(2,2) * n.z()
+        ).normalized();
+
+        // Gouraud shading lights vertices, not triangles, so it's done here as well
+        if (gouraud) {
+            m_vertexCache.intensity[k] = calculateVertexIntensity(m_vertexCache.world[k], m_vertexCache.normals[k]);
+        }
+    }
 }
 
 void Scene::setupProjectionMatrix() {
@@ -77,9 +124,15 @@ void Scene::setupProjectionMatrix() {
     m_projectionMatrix.scale(1.0f / aspectRatio, 1.0f, 1.0f);
 }
 
-QPointF Scene::project(const QVector3D& vertex, const QMatrix4x4& modelView) const {
-    QMatrix4x4 mvp = m_projectionMatrix * modelView;
+QPointF Scene::project(const QVector3D& vertex, const QMatrix4x4& modelView, float* depth) const {
+    return projectToScreen(vertex, m_projectionMatrix * modelView, depth);
+}
+
+QPointF Scene::projectToScreen(const QVector3D& vertex, const QMatrix4x4& mvp, float* depth) const {
     QVector4D clip = mvp * QVector4D(vertex, 1.0f);
+    ++m_transformedVertexCount;
+
+    if (depth) *depth = 1.0f;
 
     if (qFuzzyIsNull(clip.w())) return QPointF(-1e6, -1e6);
 
@@ -89,6 +142,10 @@ QPointF Scene::project(const QVector3D& vertex, const QMatrix4x4& modelView) con
     if (ndc4.x() < -1.0f || ndc4.x() > 1.0f || ndc4.y() < -1.0f || ndc4.y() > 1.0f || ndc4.z() < -1.0f || ndc4.z() > 1.0f)
         return QPointF(-1e6, -1e6);
 
+    // NDC z grows towards the camera, so flip it to make closer points smaller.
+    // It's z/w, hence it can be interpolated linearly in screen space.
+    if (depth) *depth = -ndc4.z();
+
     // Calculate point's screen coordinates
     float x = (ndc4.x() + 1.0f) * 0.5f * width();
     float y = (1.0f - ndc4.y()) * 0.5f * height();
@@ -153,24 +210,15 @@ void Scene::renderAxis(QPainter& painter, const QMatrix4x4& view) {
     renderArrow(painter, origin, z, Qt::blue);  // Z-Axis
 }
 
-void Scene::renderTriangles(QPainter& painter, const QMatrix4x4& modelView) {
-    const QVector<QVector3D>& vertices = m_object->getVertices();
+void Scene::renderTriangles(QPainter& painter) {
     const QVector<Triangle>& triangles = m_object->getTriangles();
-    const QVector<QVector3D>& vertexNormals = m_object->getVertexNormals();
-
-    QVector<QPointF> screenCoordinates;
-
-    for (const QVector3D& vertex : vertices) {
-        screenCoordinates.append(project(vertex, modelView));
-    }
 
-    QImage frameBuffer(width(), height(), QImage::Format_ARGB32);
-    frameBuffer.fill(Qt::transparent);
+    if (m_LightingMode == LightingMode::Simple) {
+        const QVector<QPointF>& screenCoordinates = m_vertexCache.screen;
 
-    for (const auto& triangle : triangles) {
-        if (!isFaceVisible(triangle, modelView)) continue;
+        for (const auto& triangle : triangles) {
+            if (!isFaceVisible(triangle)) continue;
 
-        if (m_LightingMode == LightingMode::Simple) {
             QPointF p1 = screenCoordinates[triangle.a];
             QPointF p2 = screenCoordinates[triangle.b];
             QPointF p3 = screenCoordinates[triangle.c];
@@ -182,13 +230,116 @@ void Scene::renderTriangles(QPainter& painter, const QMatrix4x4& modelView) {
             painter.setBrush(color);
             painter.setPen(color);
             painter.drawPolygon({p1, p2, p3});
-        } else {
-            drawTriangleGouraud(frameBuffer, triangle, modelView);
         }
+
+        return;
+    }
+
+    ensureFrameBuffer();
+    m_frameBuffer.fill(Qt::transparent);
+    std::fill(m_depthBuffer.begin(), m_depthBuffer.end(), std::numeric_limits<float>::max());
+
+    // Light and project every visible triangle up front, keeping mesh order
+    m_shadedTriangles.clear();
+    for (const auto& triangle : triangles) {
+        if (!isFaceVisible(triangle)) continue;
+        m_shadedTriangles.append(shadeTriangleGouraud(triangle));
+    }
+
+    if (m_tiledRasterization) {
+        binTriangles();
+        rasterizeTiles();
+    } else {
+        rasterizeSerial();
+    }
+
+    painter.drawImage(0, 0, m_frameBuffer);
+}
+
+void Scene::ensureFrameBuffer() {
+    if (m_frameBuffer.size() == size()) return;
+
+    m_frameBuffer = QImage(width(), height(), QImage::Format_ARGB32);
+    m_depthBuffer.resize(qsizetype(width()) * height());
+
+    // Split the framebuffer into horizontal tiles. The rasterizer steps every value from
+    // the triangle's own bounding box, so a tile produces exactly the same pixels as a full pass.
+    m_tileBins.clear();
+    for (int y = 0; y < height(); y += TILE_HEIGHT) {
+        m_tileBins.append({ y, std::min(y + TILE_HEIGHT, height()) - 1, {} });
     }
+}
+
+void Scene::binTriangles() {
+    for (TileBin& bin : m_tileBins) {
+        bin.triangles.clear();
+    }
+
+    for (int k = 0; k < m_shadedTriangles.size(); ++k) {
+        const ShadedTriangle& triangle = m_shadedTriangles[k];
 
-    if (m_LightingMode == LightingMode::GouraudShading) {
-        painter.drawImage(0, 0, frameBuffer);
+        qreal minY = std::min({ triangle.p0.y(), triangle.p1.y(), triangle.p2.y() });
+        qreal maxY = std::max({ triangle.p0.y(), triangle.p1.y(), triangle.p2.y() });
+
+        // Conservative scanline range, the rasterizer snaps vertices to a subpixel grid
+        int yStart = std::max(0, int(std::floor(minY)));
+        int yEnd   = std::min(m_frameBuffer.height() - 1, int(std::ceil(maxY)));
+        if (yStart > yEnd) continue;
+
+        for (int tile = yStart / TILE_HEIGHT; tile <= yEnd / TILE_HEIGHT; ++tile) {
+            m_tileBins[tile].triangles.append(k);
+        }
+    }
+}
+
+Scene::FrameBufferView Scene::frameBufferView() {
+    return {
+        reinterpret_cast<QRgb*>(m_frameBuffer.bits()),
+        m_frameBuffer.bytesPerLine() / qsizetype(sizeof(QRgb)),
+        m_depthBuffer.data(),
+        m_frameBuffer.width(),
+        m_frameBuffer.height()
+    };
+}
+
+void Scene::rasterizeTiles() {
+    // Grab raw pointers on the GUI thread, so worker threads never touch Qt containers themselves
+    const FrameBufferView target = frameBufferView();
+    const ShadedTriangle* shaded = m_shadedTriangles.constData();
+
+    // Tiles don't overlap and each one keeps mesh order, so overdraw resolves
+    // exactly as it would in a single-threaded pass
+    QtConcurrent::blockingMap(m_tileBins, [this, &target, shaded](const TileBin& bin) {
+        if (m_earlyDepthTest) {
+            // Resolve visibility for the whole tile first, then shade only the surviving fragments
+            for (int k : bin.triangles) {
+                Rasterizer::fillTriangle(target, shaded[k], bin.yMin, bin.yMax, RasterPass::DepthOnly);
+            }
+            for (int k : bin.triangles) {
+                Rasterizer::fillTriangle(target, shaded[k], bin.yMin, bin.yMax, RasterPass::ColorOnly);
+            }
+        } else {
+            for (int k : bin.triangles) {
+                Rasterizer::fillTriangle(target, shaded[k], bin.yMin, bin.yMax, RasterPass::DepthAndColor);
+            }
+        }
+    });
+}
+
+void Scene::rasterizeSerial() {
+    const FrameBufferView target = frameBufferView();
+
+    if (m_earlyDepthTest) {
+        for (const ShadedTriangle& triangle : std::as_const(m_shadedTriangles)) {
+            Rasterizer::fillTriangle(target, triangle, 0, target.height - 1, RasterPass::DepthOnly);
+        }
+        for (const ShadedTriangle& triangle : std::as_const(m_shadedTriangles)) {
+            Rasterizer::fillTriangle(target, triangle, 0, target.height - 1, RasterPass::ColorOnly);
+        }
+    } else {
+        for (const ShadedTriangle& triangle : std::as_const(m_shadedTriangles)) {
+            Rasterizer::fillTriangle(target, triangle, 0, target.height - 1, RasterPass::DepthAndColor);
+        }
     }
 }
 
@@ -205,18 +356,10 @@ float Scene::calculateVertexIntensity(const QVector3D& vertexWorld, const QVecto
 }
 
 float Scene::calculateLightIntensity(const Triangle& triangle) const {
-    QMatrix4x4 modelMatrix = m_object->getModelMatrix();
-    const QVector<QVector3D>& vertices = m_object->getVertices();
-
-    // Local vertices of a triangle
-    QVector3D p0 = vertices[triangle.a];
-    QVector3D p1 = vertices[triangle.b];
-    QVector3D p2 = vertices[triangle.c];
-
     // World vertices of a triangle
-    QVector3D p0_world = modelMatrix.map(p0);
-    QVector3D p1_world = modelMatrix.map(p1);
-    QVector3D p2_world = modelMatrix.map(p2);
+    const QVector3D& p0_world = m_vertexCache.world[triangle.a];
+    const QVector3D& p1_world = m_vertexCache.world[triangle.b];
+    const QVector3D& p2_world = m_vertexCache.world[triangle.c];
 
     // 2 vectors on a surface of a triangle
     QVector3D A = p1_world - p0_world;
@@ -235,122 +378,17 @@ float Scene::calculateLightIntensity(const Triangle& triangle) const {
     return intensity;
 }
 
-void Scene::drawTriangleGouraud(QImage& frameBuffer, const Triangle& triangle, const QMatrix4x4& modelView) {
-    const QVector<QVector3D>& vertices = m_object->getVertices();
-    const QVector<QVector3D>& vertexNormals = m_object->getVertexNormals();
-    QMatrix4x4 model = m_object->getModelMatrix();
-    QMatrix3x3 normalMatrix = model.normalMatrix();
+Scene::ShadedTriangle Scene::shadeTriangleGouraud(const Triangle& triangle) const {
+    // Everything was already lit and projected in the vertex stage
+    const QVector<QPointF>& screen = m_vertexCache.screen;
+    const QVector<float>& intensity = m_vertexCache.intensity;
+    const QVector<float>& depth = m_vertexCache.depth;
 
-    auto transformNormal = [](const QMatrix3x3& m, const QVector3D& n) {
-        return QVector3D(
-            m(0,0) * n.x() + m(0,1) * n.y() + m(0,2) * n.z(),
-            m(1,0) * n.x() + m(1,1) * n.y() + m(1,2) * n.z(),
-            m(2,0) * n.x() + m(2,1) * n.y() + m(2,2) * n.z()
-        );
+    return {
+        screen[triangle.a], screen[triangle.b], screen[triangle.c],
+        intensity[triangle.a], intensity[triangle.b], intensity[triangle.c],
+        depth[triangle.a], depth[triangle.b], depth[triangle.c]
     };
-
-    // Get vertices in world space
-    const QVector3D& v0 = vertices[triangle.a];
-    const QVector3D& v1 = vertices[triangle.b];
-    const QVector3D& v2 = vertices[triangle.c];
-
-    QVector3D v0_world = model.map(v0);
-    QVector3D v1_world = model.map(v1);
-    QVector3D v2_world = model.map(v2);
-
-    // Get vertex normals in world space
-    const QVector3D& n0 = vertexNormals[triangle.a];
-    const QVector3D& n1 = vertexNormals[triangle.b];
-    const QVector3D& n2 = vertexNormals[triangle.c];
-
-    QVector3D n0_world = transformNormal(normalMatrix, n0).normalized();
-    QVector3D n1_world = transformNormal(normalMatrix, n1).normalized();
-    QVector3D n2_world = transformNormal(normalMatrix, n2).normalized();
-
-    // Calculate intensity at each vertex
-    float i0 = calculateVertexIntensity(v0_world, n0_world);
-    float i1 = calculateVertexIntensity(v1_world, n1_world);
-    float i2 = calculateVertexIntensity(v2_world, n2_world);
-
-    // Project each vertex onto a 2D scene
-    QPointF p0 = project(v0, modelView);
-    QPointF p1 = project(v1, modelView);
-    QPointF p2 = project(v2, modelView);
-
-    // Fill the triangle using Gouraud shading
-    fillTriangleGouraud(frameBuffer, p0,i0, p1,i1, p2,i2);
-}
-
-void Scene::fillTriangleGouraud(
-    QImage& frameBuffer,
-    const QPointF& p0, float i0,
-    const QPointF& p1, float i1,
-    const QPointF& p2, float i2)
-{
-    // Struct that combines the vertex and its intensity
-    struct Vertex2D {
-        qreal x, y, i;
-    };
-
-    Vertex2D v[3] = {
-        { p0.x(), p0.y(), i0 },
-        { p1.x(), p1.y(), i1 },
-        { p2.x(), p2.y(), i2 }
-    };
-
-    // Sort by Y ascending
-    std::sort(v, v + 3, [](auto& a, auto& b) { return a.y < b.y; });
-
-    // Interpolate X and intensity at a given Y along the edge of a triangle
-    auto interpolateEdgeAtY = [](const Vertex2D& start, const Vertex2D& end, float y) {
-        // Y-distance from start to end for a given Y
-        float t = (end.y == start.y) ? 0.0f : (y - start.y) / (end.y - start.y);
-        float x = start.x + t * (end.x - start.x);
-        float intensity = start.i + t * (end.i - start.i);
-        return std::pair<float, float>(x, intensity);
-    };
-
-    // Draw horizontal scanline at a given Y from x1 to x2
-    auto drawHorizontalScanline = [&](int y, float x1, float i1, float x2, float i2) {
-        if (x1 > x2) {
-            std::swap(x1, x2);
-            std::swap(i1, i2);
-        }
-
-        // Convert to a pixel coordinates
-        int xStart = std::max(0, int(std::ceil(x1)));
-        int xEnd   = std::min(frameBuffer.width() - 1, int(std::floor(x2)));
-
-        float dx = x2 - x1; // Horizontal length of a scanline
-        float di = (dx != 0) ? (i2 - i1) / dx : 0.0f; // Intensity increment per pixel
-
-        QRgb* line = reinterpret_cast<QRgb*>(frameBuffer.scanLine(y)); // Raw pointer to a y-th framebuffer row
-        float currI = i1 + (xStart - x1) * di;
-
-        // Loop over each pixel in y-th row
-        for (int x = xStart; x <= xEnd; ++x) {
-            int val = std::clamp(int(currI * 255), 0, 255); // Calculate intensity for current pixel
-            line[x] = qRgb(val, val, val); // Set the pixel color
-            currI += di; // Increment intensity by di
-        }
-    };
-
-    // Convert to a pixel coordinates
-    int yStart = std::max(0, int(std::ceil(v[0].y)));
-    int yEnd   = std::min(frameBuffer.height() - 1, int(std::floor(v[2].y)));
-
-    // Loop over each scanline from top to bottom of a current triangle
-    for (int y = yStart; y <= yEnd; ++y) {
-        if (y < v[1].y) { // Upper half of a triangle
-            auto [xL, iL] = interpolateEdgeAtY(v[0], v[1], y);
-            auto [xR, iR] = interpolateEdgeAtY(v[0], v[2], y);
-            drawHorizontalScanline(y, xL, iL, xR, iR);
-        } else { // Lower half
-            auto [xL, iL] = interpolateEdgeAtY(v[1], v[2], y);
-            auto [xR, iR] = interpolateEdgeAtY(v[0], v[2], y);
-            drawHorizontalScanline(y, xL, iL, xR, iR);
-        }
-    }
 }
 
 void Scene::mousePressEvent(QMouseEvent *event) {
@@ -423,17 +461,11 @@ Object* Scene::getObject() const {
     return m_object;
 }
 
-bool Scene::isFaceVisible(const Triangle& triangle, const QMatrix4x4& modelView) const {
-    // Get first three vertices of a face
-    const QVector<QVector3D>& vertices = m_object->getVertices();
-
-    QVector3D p0 = vertices[triangle.a];
-    QVector3D p1 = vertices[triangle.b];
-    QVector3D p2 = vertices[triangle.c];
-
-    QVector3D p0_transformed = modelView.map(p0);
-    QVector3D p1_transformed = modelView.map(p1);
-    QVector3D p2_transformed = modelView.map(p2);
+bool Scene::isFaceVisible(const Triangle& triangle) const {
+    // Get view space vertices of a face
+    const QVector3D& p0_transformed = m_vertexCache.view[triangle.a];
+    const QVector3D& p1_transformed = m_vertexCache.view[triangle.b];
+    const QVector3D& p2_transformed = m_vertexCache.view[triangle.c];
 
     // Create 2 vectors based on this points
     QVector3D A = p1_transformed - p0_transformed;
@@ -467,3 +499,15 @@ float Scene::getAmbientLightIntensity() const {
 void Scene::setAmbientLightIntensity(int value) {
     m_ambientIntensity = value / 100.0f;
 }
+
+int Scene::getTransformedVertexCount() const {
+    return m_transformedVertexCount;
+}
+
+void Scene::setTiledRasterization(bool enabled) {
+    m_tiledRasterization = enabled;
+}
+
+void Scene::setEarlyDepthTest(bool enabled) {
+    m_earlyDepthTest = enabled;
+}
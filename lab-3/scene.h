@@ -9,16 +9,21 @@
 #include <QTimer>
 #include <QWheelEvent>
 #include <QKeyEvent>
+#include <QImage>
 
 #include "object.h"
 #include "lightsource.h"
 #include "camera.h"
+#include "rasterizer.h"
 
 using Triangle = Object::Triangle;
 
 class Scene : public QWidget
 {
     Q_OBJECT
+    // Headless benchmark (bench/) drives the rendering stages directly
+    friend class SceneBenchmark;
+
 public:
     explicit Scene(QWidget *parent = nullptr);
     virtual ~Scene();
@@ -37,6 +42,12 @@ public:
     Object* getObject() const;
     LightSource* getLightSource() const;
     float getAmbientLightIntensity() const;
+    // Number of points projected during the last frame: the object's vertices plus the axis end points
+    int getTransformedVertexCount() const;
+    // Toggle between tiled multithreaded and single-threaded Gouraud rasterization
+    void setTiledRasterization(bool enabled);
+    // Toggle the depth-only pre-pass that rejects hidden fragments before shading
+    void setEarlyDepthTest(bool enabled);
 
 protected:
     // Events
@@ -55,19 +66,53 @@ private:
     void renderAxis(QPainter& painter, const QMatrix4x4& view);
     void renderArrow(QPainter& painter, QPointF start, QPointF end, const QColor& color);
     // Project 3D point onto a 2D plane
-    QPointF project(const QVector3D& vertex, const QMatrix4x4& modelView) const;
+    // (optionally reports the vertex depth, smaller values are closer to the camera)
+    QPointF project(const QVector3D& vertex, const QMatrix4x4& modelView, float* depth = nullptr) const;
+    // Same as project(), but with an already combined model-view-projection matrix
+    QPointF projectToScreen(const QVector3D& vertex, const QMatrix4x4& mvp, float* depth = nullptr) const;
+    // Vertex stage: transform and light every vertex of the object once per frame
+    void transformVertices(const QMatrix4x4& model, const QMatrix4x4& view);
     // Determine if a triangle is facing the camera (back-face culling)
-    bool isFaceVisible(const Triangle& triangle, const QMatrix4x4& modelView) const;
+    bool isFaceVisible(const Triangle& triangle) const;
     // Render all triangles of the object
-    void renderTriangles(QPainter& painter, const QMatrix4x4& modelView);
+    void renderTriangles(QPainter& painter);
     // Calculate lighting intensity for a triangle (flat shading)
     float calculateLightIntensity(const Triangle& triangle) const;
     // Calculate lighting intensity for a vertex (used in Gouraud shading)
     float calculateVertexIntensity(const QVector3D& vertexWorld, const QVector3D& normalWorld) const;
-    // Apply Gouraud shading to a triangle and draw it into the framebuffer
-    void drawTriangleGouraud(QImage& frameBuffer, const Triangle& triangle, const QMatrix4x4& modelView);
-    // Fill a triangle using interpolated vertex intensities (helper for Gouraud shading)
-    void fillTriangleGouraud(QImage& frameBuffer, const QPointF& p0, float i0, const QPointF& p1, float i1, const QPointF& p2, float i2);
+
+    using ShadedTriangle = Rasterizer::ShadedTriangle;
+    using RasterPass = Rasterizer::Pass;
+    using FrameBufferView = Rasterizer::FrameBufferView;
+
+    // Output of the vertex stage, indexed the same way as the object's vertices
+    struct VertexCache {
+        QVector<QVector3D> world;   // World space positions
+        QVector<QVector3D> view;    // View space positions
+        QVector<QPointF> screen;    // Screen space positions
+        QVector<float> depth;       // Screen space depth
+        QVector<QVector3D> normals; // World space normals
+        QVector<float> intensity;   // Gouraud intensity (only filled in Gouraud mode)
+    };
+
+    // Horizontal strip of the framebuffer together with the triangles that overlap it
+    struct TileBin {
+        int yMin, yMax;          // Scanline range covered by the tile (inclusive)
+        QVector<int> triangles;  // Indices into m_shadedTriangles, in mesh order
+    };
+
+    // Apply Gouraud shading to a triangle's vertices and project them onto the screen
+    ShadedTriangle shadeTriangleGouraud(const Triangle& triangle) const;
+    // Raw pixel access to the persistent framebuffer
+    FrameBufferView frameBufferView();
+    // Reallocate the persistent framebuffer and tile bins if the widget size has changed
+    void ensureFrameBuffer();
+    // Sort shaded triangles into the tiles they overlap
+    void binTriangles();
+    // Rasterize all shaded triangles, tile by tile on the thread pool
+    void rasterizeTiles();
+    // Rasterize all shaded triangles on the calling thread
+    void rasterizeSerial();
 
 private:
     Object* m_object;                // Pointer to the object
@@ -83,6 +128,18 @@ private:
     float m_rotationSensitivity;
 
     LightingMode m_LightingMode; // Current lighting mode
+
+    VertexCache m_vertexCache;    // Per-frame transformed vertices
+    mutable int m_transformedVertexCount; // Points projected since the vertex stage of the last frame started
+
+    static constexpr int TILE_HEIGHT = 32; // Height of a single tile in scanlines
+
+    bool m_tiledRasterization;                 // Whether Gouraud triangles are rasterized on the thread pool
+    bool m_earlyDepthTest;                     // Whether a depth-only pre-pass runs before shading
+    QImage m_frameBuffer;                      // Persistent Gouraud framebuffer, reused between frames
+    QVector<float> m_depthBuffer;              // Per-pixel depth, same dimensions as m_frameBuffer
+    QVector<ShadedTriangle> m_shadedTriangles; // Triangles prepared for rasterization this frame
+    QVector<TileBin> m_tileBins;               // Per-tile triangle lists
 };
 
 #endif // SCENE_H
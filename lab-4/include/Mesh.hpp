@@ -2,6 +2,7 @@
 #define MESH_HPP
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 
 #include "stb_image.h"
 
@@ -9,14 +10,31 @@
 
 class Mesh {
 public:
-    void setup();
+    // Welds duplicate vertices into an index buffer; with optimizeCache the triangles are also
+    // reordered for the vertex cache, which assumes the mesh is drawn as GL_TRIANGLES
+    void setup(bool optimizeCache = true);
     void draw(GLenum mode = GL_TRIANGLES);
     void destroy();
 
+    // Per-instance model matrices for drawInstanced(), after setup(). The shaders multiply the
+    // model uniform by the instance matrix, so an instanced draw takes its transforms from here.
+    void setInstances(const std::vector<glm::mat4>& transforms);
+    void drawInstanced(GLenum mode = GL_TRIANGLES);
+
+    // Values the shaders read from attributes a VAO doesn't enable: white for the vertex color,
+    // identity for the instance matrix. They're context state, so setting them once is enough.
+    static void setDefaultAttributes();
+
 public:
-    unsigned int VAO = 0, VBO = 0;
+    static constexpr int FLOATS_PER_VERTEX = 8; // Position, normal, texture coordinates
+    static constexpr GLuint INSTANCE_ATTRIBUTE = 4; // Model matrix, one location per column
+
+    unsigned int VAO = 0, VBO = 0, EBO = 0, instanceVBO = 0;
     std::vector<float> vertices;
-    size_t vertexCount;
+    std::vector<unsigned int> indices;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    size_t instanceCount = 0;
 };
 
-#endif // MESH_HPP
\ No newline at end of file
+#endif // MESH_HPP
@@ -0,0 +1,25 @@
+#ifndef MESH_OPTIMIZER_HPP
+#define MESH_OPTIMIZER_HPP
+
+#include <cstddef>
+#include <vector>
+
+// CPU-side preparation of indexed triangle lists, run once when a mesh is uploaded
+class MeshOptimizer {
+public:
+    // Merge bit-identical vertices (stride floats each) of a flat vertex list: vertices keeps the
+    // unique ones in order of first appearance, indices gets one entry per original vertex
+    static void weld(std::vector<float>& vertices, int stride, std::vector<unsigned int>& indices);
+
+    // Reorder triangles for the post-transform vertex cache (Tom Forsyth's linear-speed
+    // algorithm), so consecutive triangles reuse the vertices the GPU has just shaded
+    static void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+    // Renumber vertices in the order the indices first use them, so fetches walk the buffer forward
+    static void optimizeVertexFetch(std::vector<float>& vertices, int stride, std::vector<unsigned int>& indices);
+
+private:
+    static constexpr int CACHE_SIZE = 32; // Modelled cache for the scoring, larger than most real ones
+};
+
+#endif // MESH_OPTIMIZER_HPP
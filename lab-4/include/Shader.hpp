@@ -8,9 +8,19 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
 
 class Shader {
 public:
+    // Handle to an active uniform of type T, resolved once by name. A handle to a uniform the
+    // program doesn't have (or of another type) is invalid, and setting it does nothing.
+    template <typename T>
+    struct Uniform {
+        int slot = -1;
+        bool valid() const { return slot >= 0; }
+    };
+
     Shader(const char* vertexPath, const char* fragmentPath);
     ~Shader();
 
@@ -20,7 +30,22 @@ public:
     // Use the shader
     void use();
 
-    // Utility uniform functions
+    // Read the named uniform block from the buffer at bindingPoint, if the program has it
+    void bindUniformBlock(const std::string& name, GLuint bindingPoint);
+
+    template <typename T>
+    Uniform<T> uniform(const std::string& name) const {
+        return Uniform<T>{ findUniform(name, glTypeOf(static_cast<const T*>(nullptr))) };
+    }
+
+    // Typed setters; values equal to the last one uploaded are skipped
+    void set(Uniform<bool> uniform, bool value) const;
+    void set(Uniform<int> uniform, int value) const;
+    void set(Uniform<float> uniform, float value) const;
+    void set(Uniform<glm::mat4> uniform, const glm::mat4& mat) const;
+    void set(Uniform<glm::vec3> uniform, const glm::vec3& v) const;
+
+    // Utility uniform functions, by name through the same cache
     void setBool(const std::string& name, bool value) const;
     void setInt(const std::string& name, int value) const;
     void setFloat(const std::string& name, float value) const;
@@ -29,6 +54,32 @@ public:
 
     public:
     unsigned int m_programID; // Shader program ID
+
+private:
+    struct UniformSlot {
+        GLint location;
+        GLenum type;
+        bool uploaded = false;
+        unsigned char value[sizeof(glm::mat4)] = {}; // Last value sent, to skip redundant uploads
+    };
+
+    // Look up every active uniform once after linking, array elements included
+    void reflectUniforms();
+    void addUniform(const std::string& name, GLenum type);
+
+    // Slot of the uniform, -1 if there's none or its type isn't the expected one (GL_NONE: any)
+    int findUniform(const std::string& name, GLenum type = GL_NONE) const;
+    // Remember value for the slot, false if it's what the program already holds
+    bool store(int slot, const void* value, size_t size) const;
+
+    static GLenum glTypeOf(const bool*) { return GL_BOOL; }
+    static GLenum glTypeOf(const int*) { return GL_INT; }
+    static GLenum glTypeOf(const float*) { return GL_FLOAT; }
+    static GLenum glTypeOf(const glm::vec3*) { return GL_FLOAT_VEC3; }
+    static GLenum glTypeOf(const glm::mat4*) { return GL_FLOAT_MAT4; }
+
+    std::unordered_map<std::string, int> m_uniformSlots;
+    mutable std::vector<UniformSlot> m_uniforms;
 };
 
-#endif // SHADER_H
\ No newline at end of file
+#endif // SHADER_H
@@ -0,0 +1,31 @@
+#ifndef STATIC_BATCH_HPP
+#define STATIC_BATCH_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+
+#include <vector>
+
+// Geometry that never moves and shares one texture and material, merged into a single buffer.
+// Meshes are added with their model matrix and color, which are baked into the vertices, so the
+// whole batch is one draw call with an identity model matrix.
+class StaticBatch {
+public:
+    // Takes the mesh's CPU-side vertices (indices too, if it was set up), it needn't be uploaded
+    void add(const Mesh& mesh, const glm::mat4& model, const glm::vec3& color);
+    void setup();
+    void draw();
+    void destroy();
+
+public:
+    static constexpr int FLOATS_PER_VERTEX = 11; // Mesh's layout followed by the color
+
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    size_t indexCount = 0;
+};
+
+#endif // STATIC_BATCH_HPP
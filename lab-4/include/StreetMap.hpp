@@ -3,9 +3,13 @@
 
 #include "Mesh.hpp"
 #include "Shader.hpp"
+#include "StaticBatch.hpp"
+#include "UniformBuffer.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+#include <deque>
 #include <vector>
 #include <cmath>
 
@@ -14,8 +18,11 @@ public:
     void init();
     void cleanup();
     void drawLitObjects(Shader& shader);
+    // Depth-only pass: the same geometry as drawLitObjects, without material state
+    void drawShadowCasters(Shader& shader);
     void drawEmissives(Shader& shader);
-    void applyLightningState(Shader& shader);
+    // Upload the lights to their uniform block, if they changed since the last call
+    void applyLightningState();
     
 private:
     void loadTextures();
@@ -44,6 +51,11 @@ private:
     void initBenches();
     void initLampModel();
     void initLamps();
+    void initStaticBatches();
+
+    // Batch of the given texture and material, created on first use
+    StaticBatch& staticBatch(GLuint texture, float shininess);
+    void drawFurniture(Shader& shader);
 
     GLuint loadTexture(const char *path);
 
@@ -61,6 +73,16 @@ private:
 
     GLuint m_blackTexture;
 
+    // Everything that doesn't move, one batch per texture and shininess. The meshes below that go
+    // into batches only hold geometry for initStaticBatches() and are never uploaded themselves.
+    // A deque keeps references from staticBatch() valid while more batches are created.
+    struct MaterialBatch {
+        GLuint texture;
+        float shininess;
+        StaticBatch batch;
+    };
+    std::deque<MaterialBatch> m_staticBatches;
+
     // --- Road
     Mesh m_roadMesh;
     GLuint m_roadTexture;
@@ -122,6 +144,9 @@ private:
     Mesh m_lampPoleMesh;
     Mesh m_lampBulbMesh;
 
+    // Lights block shared by the lit programs
+    UniformBuffer m_lightsBuffer;
+
 public:
     std::vector<glm::vec3> m_lampPositions;
     Mesh m_lampMesh;
@@ -0,0 +1,67 @@
+#ifndef UNIFORM_BUFFER_HPP
+#define UNIFORM_BUFFER_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Binding points of the blocks every program shares
+const GLuint CAMERA_BLOCK_BINDING = 0;
+const GLuint LIGHTS_BLOCK_BINDING = 1;
+
+// Must match NR_POINT_LIGHTS in main.fs
+const int MAX_POINT_LIGHTS = 128;
+
+// std140 mirrors of the blocks in the shaders, a vec3 followed by a float shares its 16 bytes
+
+// uniform Camera
+struct CameraBlock {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 lightSpaceMatrix;
+    glm::vec3 viewPos;
+    float padding;
+};
+
+struct DirLightBlock {
+    glm::vec3 direction; float padding0;
+    glm::vec3 ambient;   float padding1;
+    glm::vec3 diffuse;   float padding2;
+    glm::vec3 specular;  float padding3;
+};
+
+struct PointLightBlock {
+    glm::vec3 position; float constant;
+    glm::vec3 ambient;  float linear;
+    glm::vec3 diffuse;  float quadratic;
+    glm::vec3 specular; float padding;
+};
+
+// uniform Lights
+struct LightsBlock {
+    DirLightBlock dirLight;
+    int numLights;
+    int padding[3];
+    PointLightBlock pointLights[MAX_POINT_LIGHTS];
+};
+
+static_assert(sizeof(CameraBlock) == 208, "Camera block doesn't match std140");
+static_assert(sizeof(PointLightBlock) == 64, "PointLight doesn't match std140");
+static_assert(sizeof(LightsBlock) == 80 + 64 * MAX_POINT_LIGHTS, "Lights block doesn't match std140");
+
+// A uniform buffer bound to a binding point, for blocks shared between programs. update() compares
+// against the last upload and sends only the bytes that changed, so unchanged data costs no upload.
+class UniformBuffer {
+public:
+    void setup(GLuint bindingPoint, size_t size);
+    void update(const void* data);
+    void destroy();
+
+private:
+    GLuint m_bufferID = 0;
+    std::vector<unsigned char> m_uploaded;
+    bool m_empty = true; // Nothing uploaded yet
+};
+
+#endif // UNIFORM_BUFFER_HPP
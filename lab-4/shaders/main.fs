@@ -15,31 +15,41 @@ struct DirLight {
     vec3 specular;
 };
 
+// Each vec3 shares its 16 bytes with the float after it
 struct PointLight {
     vec3 position;
-    
     float constant;
-    float linear;
-    float quadratic;
-	
     vec3 ambient;
+    float linear;
     vec3 diffuse;
+    float quadratic;
     vec3 specular;
 };
 
-#define NR_POINT_LIGHTS 4
+// Must match MAX_POINT_LIGHTS in UniformBuffer.hpp
+#define NR_POINT_LIGHTS 128
+
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 lightSpaceMatrix;
+    vec3 viewPos;
+};
+
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    int numLights;
+    PointLight pointLights[NR_POINT_LIGHTS];
+};
 
-uniform int numLights;
 uniform vec3 objectColor;
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 in vec4 FragPosLightSpace;
+in vec3 Color;
 
-uniform vec3 viewPos;
-uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
 uniform Material material;
 uniform sampler2D shadowMap;
 
@@ -62,7 +72,7 @@ void main()
     for(int i = 0; i < numLights; i++)
         result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);    
     
-    FragColor = vec4(result * objectColor, 1.0);
+    FragColor = vec4(result * objectColor * Color, 1.0);
 }
 
 // calculates the color when using a directional light.
@@ -1,9 +1,16 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
+layout (location = 4) in mat4 aInstanceModel; // Identity unless drawn instanced
 
-uniform mat4 lightSpaceMatrix;
 uniform mat4 model;
 
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 lightSpaceMatrix;
+    vec3 viewPos;
+};
+
 void main() {
-    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+    gl_Position = lightSpaceMatrix * model * aInstanceModel * vec4(aPos, 1.0);
 }
\ No newline at end of file
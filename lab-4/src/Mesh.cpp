@@ -1,35 +1,89 @@
 #include "Mesh.hpp"
+#include "MeshOptimizer.hpp"
+
+void Mesh::setup(bool optimizeCache) {
+    // The add* helpers emit every triangle with its own copies of shared corners
+    MeshOptimizer::weld(vertices, FLOATS_PER_VERTEX, indices);
+    if (optimizeCache) {
+        MeshOptimizer::optimizeVertexCache(indices, vertices.size() / FLOATS_PER_VERTEX);
+        MeshOptimizer::optimizeVertexFetch(vertices, FLOATS_PER_VERTEX, indices);
+    }
 
-void Mesh::setup() {
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
     glBindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
 
     // Position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
     // Normal
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)(3 * sizeof(float)));
     glEnableVertexAttribArray(1);
 
     // Texture
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)(6 * sizeof(float)));
     glEnableVertexAttribArray(2);
 
-    vertexCount = vertices.size() / 8;
+    vertexCount = vertices.size() / FLOATS_PER_VERTEX;
+    indexCount = indices.size();
     glBindVertexArray(0);
 }
 
 void Mesh::draw(GLenum mode) {
     glBindVertexArray(VAO);
-    glDrawArrays(mode, 0, vertexCount);
+    glDrawElements(mode, static_cast<GLsizei>(indexCount), GL_UNSIGNED_INT, (void*)0);
     glBindVertexArray(0);
 }
 
+void Mesh::setInstances(const std::vector<glm::mat4>& transforms) {
+    if (instanceVBO == 0) {
+        glGenBuffers(1, &instanceVBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+
+        // Model matrix, a column per location, advancing once per instance
+        for (GLuint i = 0; i < 4; ++i) {
+            glVertexAttribPointer(INSTANCE_ATTRIBUTE + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(i * sizeof(glm::vec4)));
+            glEnableVertexAttribArray(INSTANCE_ATTRIBUTE + i);
+            glVertexAttribDivisor(INSTANCE_ATTRIBUTE + i, 1);
+        }
+
+        glBindVertexArray(0);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, transforms.size() * sizeof(glm::mat4), transforms.data(), GL_STATIC_DRAW);
+    instanceCount = transforms.size();
+}
+
+void Mesh::drawInstanced(GLenum mode) {
+    if (instanceCount == 0) return;
+
+    glBindVertexArray(VAO);
+    glDrawElementsInstanced(mode, static_cast<GLsizei>(indexCount), GL_UNSIGNED_INT, (void*)0, static_cast<GLsizei>(instanceCount));
+    glBindVertexArray(0);
+}
+
+void Mesh::setDefaultAttributes() {
+    // Color
+    glVertexAttrib3f(3, 1.0f, 1.0f, 1.0f);
+
+    // Instance matrix
+    for (GLuint i = 0; i < 4; ++i) {
+        glVertexAttrib4f(INSTANCE_ATTRIBUTE + i,
+            i == 0 ? 1.0f : 0.0f, i == 1 ? 1.0f : 0.0f, i == 2 ? 1.0f : 0.0f, i == 3 ? 1.0f : 0.0f);
+    }
+}
+
 void Mesh::destroy() {
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
-}
\ No newline at end of file
+    glDeleteBuffers(1, &EBO);
+    glDeleteBuffers(1, &instanceVBO);
+}
@@ -0,0 +1,206 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+void MeshOptimizer::weld(std::vector<float>& vertices, int stride, std::vector<unsigned int>& indices) {
+    size_t count = vertices.size() / stride;
+    indices.resize(count);
+
+    // Adding 0.0f turns -0.0f into 0.0f, so both compare equal bitwise
+    for (float& value : vertices) {
+        value += 0.0f;
+    }
+
+    auto hash = [&](const float* vertex) {
+        uint32_t h = 2166136261u; // FNV-1a over the bit patterns
+        for (int i = 0; i < stride; ++i) {
+            uint32_t bits;
+            std::memcpy(&bits, &vertex[i], sizeof(bits));
+            h = (h ^ bits) * 16777619u;
+        }
+        return h;
+    };
+
+    // Open addressing, slots hold a unique vertex index + 1 (0 is empty)
+    size_t tableSize = 1;
+    while (tableSize < count * 2) tableSize <<= 1;
+    std::vector<unsigned int> table(tableSize, 0);
+
+    // Unique vertices are compacted to the front of the same array as they're found
+    unsigned int unique = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const float* vertex = &vertices[i * stride];
+        size_t slot = hash(vertex) & (tableSize - 1);
+
+        while (table[slot] != 0 &&
+               std::memcmp(&vertices[size_t(table[slot] - 1) * stride], vertex, stride * sizeof(float)) != 0) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+
+        if (table[slot] == 0) {
+            if (unique != i) {
+                std::memmove(&vertices[size_t(unique) * stride], vertex, stride * sizeof(float));
+            }
+            table[slot] = ++unique;
+        }
+        indices[i] = table[slot] - 1;
+    }
+
+    vertices.resize(size_t(unique) * stride);
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0) return;
+
+    // Score of a vertex by its position in the modelled LRU cache: the last triangle's three are
+    // fixed at 0.75 so that strips aren't favoured over fans, older ones fall off towards the end
+    float cacheScores[CACHE_SIZE];
+    for (int i = 0; i < CACHE_SIZE; ++i) {
+        cacheScores[i] = i < 3 ? 0.75f : std::pow(1.0f - float(i - 3) / (CACHE_SIZE - 3), 1.5f);
+    }
+
+    // Bonus for vertices with few triangles left, so lone ones get finished instead of stranded
+    const int MAX_VALENCE = 32;
+    float valenceScores[MAX_VALENCE];
+    for (int i = 0; i < MAX_VALENCE; ++i) {
+        valenceScores[i] = i == 0 ? 0.0f : 2.0f / std::sqrt(float(i));
+    }
+
+    // Triangles around each vertex, as ranges of one shared array
+    std::vector<unsigned int> valence(vertexCount, 0);
+    for (unsigned int index : indices) {
+        ++valence[index];
+    }
+
+    std::vector<unsigned int> firstTriangle(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        firstTriangle[v + 1] = firstTriangle[v] + valence[v];
+    }
+
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            unsigned int v = indices[t * 3 + k];
+            adjacency[filled[v]++] = static_cast<unsigned int>(t);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount, 0.0f);
+    auto scoreVertex = [&](unsigned int v) {
+        unsigned int remaining = valence[v];
+        if (remaining == 0) return -1.0f;
+
+        float score = cachePosition[v] < 0 ? 0.0f : cacheScores[cachePosition[v]];
+        return score + valenceScores[remaining < MAX_VALENCE ? remaining : MAX_VALENCE - 1];
+    };
+
+    for (size_t v = 0; v < vertexCount; ++v) {
+        vertexScore[v] = scoreVertex(static_cast<unsigned int>(v));
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+
+    // Cache contents, most recent first, with room for the three vertices pushed in front
+    std::vector<unsigned int> cache;
+    std::vector<unsigned int> nextCache;
+    cache.reserve(CACHE_SIZE + 3);
+    nextCache.reserve(CACHE_SIZE + 3);
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+
+    size_t scanCursor = 0; // Triangles before it are all emitted
+    long best = -1;
+
+    while (result.size() < indices.size()) {
+        // No candidate around the cache: start a new island at the first triangle left in the
+        // original order, which keeps the whole pass linear
+        if (best < 0) {
+            while (emitted[scanCursor]) ++scanCursor;
+            best = static_cast<long>(scanCursor);
+        }
+
+        emitted[best] = true;
+        nextCache.clear();
+
+        for (int k = 0; k < 3; ++k) {
+            unsigned int v = indices[best * 3 + k];
+            result.push_back(v);
+            if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end()) nextCache.push_back(v);
+
+            // Drop the emitted triangle from the vertex's remaining list
+            unsigned int* begin = &adjacency[firstTriangle[v]];
+            unsigned int* end = begin + valence[v];
+            for (unsigned int* it = begin; it != end; ++it) {
+                if (*it == static_cast<unsigned int>(best)) {
+                    *it = *(end - 1);
+                    break;
+                }
+            }
+            --valence[v];
+        }
+
+        size_t fresh = nextCache.size();
+        for (unsigned int v : cache) {
+            if (std::find(nextCache.begin(), nextCache.begin() + fresh, v) == nextCache.begin() + fresh) nextCache.push_back(v);
+        }
+
+        // Vertices pushed out of the cache lose their position score
+        for (size_t i = CACHE_SIZE; i < nextCache.size(); ++i) {
+            cachePosition[nextCache[i]] = -1;
+            vertexScore[nextCache[i]] = scoreVertex(nextCache[i]);
+        }
+        if (nextCache.size() > CACHE_SIZE) nextCache.resize(CACHE_SIZE);
+        cache.swap(nextCache);
+
+        // Rescore what's in the cache and the triangles around it, the next pick is the best of those
+        for (size_t i = 0; i < cache.size(); ++i) {
+            cachePosition[cache[i]] = static_cast<int>(i);
+        }
+        for (unsigned int v : cache) {
+            vertexScore[v] = scoreVertex(v);
+        }
+
+        best = -1;
+        float bestScore = -1.0f;
+        for (unsigned int v : cache) {
+            for (unsigned int i = 0; i < valence[v]; ++i) {
+                unsigned int t = adjacency[firstTriangle[v] + i];
+                float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<float>& vertices, int stride, std::vector<unsigned int>& indices) {
+    size_t vertexCount = vertices.size() / stride;
+    const unsigned int UNUSED = ~0u;
+
+    std::vector<unsigned int> remap(vertexCount, UNUSED);
+    std::vector<float> reordered;
+    reordered.reserve(vertices.size());
+
+    unsigned int next = 0;
+    for (unsigned int& index : indices) {
+        if (remap[index] == UNUSED) {
+            remap[index] = next++;
+            reordered.insert(reordered.end(), vertices.begin() + size_t(index) * stride, vertices.begin() + size_t(index + 1) * stride);
+        }
+        index = remap[index];
+    }
+
+    // Vertices no index refers to are dropped
+    vertices.swap(reordered);
+}
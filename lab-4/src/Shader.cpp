@@ -1,5 +1,7 @@
 #include "Shader.hpp"
 
+#include <cstring>
+
 Shader::Shader(const char* vertexPath, const char* fragmentPath) {
     std::string vertexCode, fragmentCode;
     std::ifstream vShaderFile, fShaderFile;
@@ -48,6 +50,7 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
     glAttachShader(m_programID, fragmentID);
     glLinkProgram(m_programID);
     checkProgramLink(m_programID);
+    reflectUniforms();
 
     // Delete linked shaders
     glDeleteShader(vertexID);
@@ -86,22 +89,123 @@ void Shader::use() {
     glUseProgram(m_programID);
 }
 
+void Shader::bindUniformBlock(const std::string& name, GLuint bindingPoint) {
+    GLuint index = glGetUniformBlockIndex(m_programID, name.c_str());
+    if (index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(m_programID, index, bindingPoint);
+    }
+}
+
+void Shader::reflectUniforms() {
+    GLint count = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(m_programID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(m_programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<char> buffer(maxLength > 0 ? maxLength : 1);
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = GL_NONE;
+        glGetActiveUniform(m_programID, i, static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+        std::string name(buffer.data(), length);
+
+        // Arrays of plain types come once as "name[0]", with their size; structs come per member.
+        // The bare name is the first element, it shares that slot so both see the same last value.
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            std::string base = name.substr(0, name.size() - 3);
+            for (GLint element = 0; element < size; ++element) {
+                addUniform(base + "[" + std::to_string(element) + "]", type);
+            }
+
+            auto first = m_uniformSlots.find(name);
+            if (first != m_uniformSlots.end()) m_uniformSlots[base] = first->second;
+        } else {
+            addUniform(name, type);
+        }
+    }
+}
+
+void Shader::addUniform(const std::string& name, GLenum type) {
+    // Members of uniform blocks have no location
+    GLint location = glGetUniformLocation(m_programID, name.c_str());
+    if (location < 0) return;
+
+    m_uniformSlots[name] = static_cast<int>(m_uniforms.size());
+    m_uniforms.push_back({ location, type });
+}
+
+int Shader::findUniform(const std::string& name, GLenum type) const {
+    auto it = m_uniformSlots.find(name);
+    if (it == m_uniformSlots.end()) return -1;
+
+    // Samplers are set as integers
+    GLenum actual = m_uniforms[it->second].type;
+    bool isSampler = actual == GL_SAMPLER_2D || actual == GL_SAMPLER_CUBE;
+    if (type != GL_NONE && type != actual && !(type == GL_INT && isSampler)) {
+        std::cerr << "Uniform " << name << " has a different type" << std::endl;
+        return -1;
+    }
+
+    return it->second;
+}
+
+bool Shader::store(int slot, const void* value, size_t size) const {
+    UniformSlot& uniform = m_uniforms[slot];
+    if (uniform.uploaded && std::memcmp(uniform.value, value, size) == 0) return false;
+
+    std::memcpy(uniform.value, value, size);
+    uniform.uploaded = true;
+    return true;
+}
+
+void Shader::set(Uniform<bool> uniform, bool value) const {
+    int v = static_cast<int>(value);
+    if (uniform.valid() && store(uniform.slot, &v, sizeof(v))) {
+        glUniform1i(m_uniforms[uniform.slot].location, v);
+    }
+}
+
+void Shader::set(Uniform<int> uniform, int value) const {
+    if (uniform.valid() && store(uniform.slot, &value, sizeof(value))) {
+        glUniform1i(m_uniforms[uniform.slot].location, value);
+    }
+}
+
+void Shader::set(Uniform<float> uniform, float value) const {
+    if (uniform.valid() && store(uniform.slot, &value, sizeof(value))) {
+        glUniform1f(m_uniforms[uniform.slot].location, value);
+    }
+}
+
+void Shader::set(Uniform<glm::mat4> uniform, const glm::mat4& mat) const {
+    if (uniform.valid() && store(uniform.slot, &mat[0][0], sizeof(glm::mat4))) {
+        glUniformMatrix4fv(m_uniforms[uniform.slot].location, 1, GL_FALSE, &mat[0][0]);
+    }
+}
+
+void Shader::set(Uniform<glm::vec3> uniform, const glm::vec3& v) const {
+    if (uniform.valid() && store(uniform.slot, &v[0], sizeof(glm::vec3))) {
+        glUniform3fv(m_uniforms[uniform.slot].location, 1, &v[0]);
+    }
+}
+
 void Shader::setBool(const std::string &name, bool value) const {
-    glUniform1i(glGetUniformLocation(m_programID, name.c_str()), static_cast<int>(value));
+    set(Uniform<bool>{ findUniform(name) }, value);
 }
 
 void Shader::setInt(const std::string &name, int value) const {
-    glUniform1i(glGetUniformLocation(m_programID, name.c_str()), value);
+    set(Uniform<int>{ findUniform(name) }, value);
 }
 
 void Shader::setFloat(const std::string &name, float value) const {
-    glUniform1f(glGetUniformLocation(m_programID, name.c_str()), value);
+    set(Uniform<float>{ findUniform(name) }, value);
 }
 
 void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(m_programID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    set(Uniform<glm::mat4>{ findUniform(name) }, mat);
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& v) const {
-    glUniform3fv(glGetUniformLocation(m_programID, name.c_str()), 1, &v[0]);
+    set(Uniform<glm::vec3>{ findUniform(name) }, v);
 }
\ No newline at end of file
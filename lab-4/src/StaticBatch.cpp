@@ -0,0 +1,83 @@
+#include "StaticBatch.hpp"
+#include "MeshOptimizer.hpp"
+
+void StaticBatch::add(const Mesh& mesh, const glm::mat4& model, const glm::vec3& color) {
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+    size_t count = mesh.vertices.size() / Mesh::FLOATS_PER_VERTEX;
+    unsigned int base = static_cast<unsigned int>(vertices.size() / FLOATS_PER_VERTEX);
+
+    for (size_t i = 0; i < count; ++i) {
+        const float* v = &mesh.vertices[i * Mesh::FLOATS_PER_VERTEX];
+        glm::vec4 position = model * glm::vec4(v[0], v[1], v[2], 1.0f);
+        glm::vec3 normal = glm::normalize(normalMatrix * glm::vec3(v[3], v[4], v[5]));
+
+        vertices.insert(vertices.end(), {
+            position.x, position.y, position.z,
+            normal.x, normal.y, normal.z,
+            v[6], v[7],
+            color.x, color.y, color.z
+        });
+    }
+
+    // A mesh that was never set up is a plain triangle list
+    if (mesh.indices.empty()) {
+        for (size_t i = 0; i < count; ++i) {
+            indices.push_back(base + static_cast<unsigned int>(i));
+        }
+    } else {
+        for (unsigned int index : mesh.indices) {
+            indices.push_back(base + index);
+        }
+    }
+}
+
+void StaticBatch::setup() {
+    // Meshes added unwelded, or touching after the transform, share vertices now
+    std::vector<unsigned int> remap;
+    MeshOptimizer::weld(vertices, FLOATS_PER_VERTEX, remap);
+    for (unsigned int& index : indices) {
+        index = remap[index];
+    }
+    MeshOptimizer::optimizeVertexCache(indices, vertices.size() / FLOATS_PER_VERTEX);
+    MeshOptimizer::optimizeVertexFetch(vertices, FLOATS_PER_VERTEX, indices);
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+    // Position
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // Normal
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    // Texture
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    // Color
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)(8 * sizeof(float)));
+    glEnableVertexAttribArray(3);
+
+    indexCount = indices.size();
+    glBindVertexArray(0);
+}
+
+void StaticBatch::draw() {
+    glBindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indexCount), GL_UNSIGNED_INT, (void*)0);
+    glBindVertexArray(0);
+}
+
+void StaticBatch::destroy() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+}
@@ -1,6 +1,8 @@
 #include "StreetMap.hpp"
 
 void StreetMap::init() {
+    Mesh::setDefaultAttributes();
+    m_lightsBuffer.setup(LIGHTS_BLOCK_BINDING, sizeof(LightsBlock));
     loadTextures();
     
     genBlackTexture();
@@ -12,6 +14,7 @@ void StreetMap::init() {
     initShop3();
     initShop4();
     initShop5();
+    initStaticBatches();
     initBenches();
     initLamps();
 }
@@ -72,8 +75,6 @@ void StreetMap::initRoad() {
         roadInner, roadOuter,
         vLength,   uWidth 
     );
-
-    m_roadMesh.setup();
 }
 
 void StreetMap::initCurbs() {
@@ -151,8 +152,6 @@ void StreetMap::initCurbs() {
         true
     );
 
-    m_innerCurbMesh.setup();
-    
     // 2. Outer curb
     // Vertical
     addRectangle(m_outerCurbMesh.vertices,
@@ -216,8 +215,6 @@ void StreetMap::initCurbs() {
         (roadOuter + m_curbWidth) * uvScale,
         false
     );
-
-    m_outerCurbMesh.setup();
 }
 
 void StreetMap::initSidewalks() {
@@ -232,8 +229,6 @@ void StreetMap::initSidewalks() {
         m_innerSidewalkLength * uvScale, m_innerSidewalkLength * uvScale 
     );    
 
-    m_innerSidewalkMesh.setup();
-
     // 2. Outer sidewalk
     addRectangle(m_outerSidewalkMesh.vertices,
         m_outerVerticalSidewalkLength,                                0.0f,                                   // Top left
@@ -258,8 +253,6 @@ void StreetMap::initSidewalks() {
         m_outerVerticalSidewalkLength,           m_outerVerticalSidewalkLength + m_outerHorizontalSidewalkWidth,
         m_outerVerticalSidewalkLength * uvScale, m_outerHorizontalSidewalkWidth * uvScale                       
     );
-
-    m_outerSidewalkMesh.setup();
 }
 
 void StreetMap::initShop1() {
@@ -275,7 +268,6 @@ void StreetMap::initShop1() {
 
     // --- Base
     addCube(m_shop1BaseMesh.vertices, x, 0.0001f, z, w, h, d, uvScale);
-    m_shop1BaseMesh.setup();
     
     // --- Roof
     addCube(m_shop1RoofMesh.vertices,
@@ -288,11 +280,8 @@ void StreetMap::initShop1() {
         uvScale
     );
     
-    m_shop1RoofMesh.setup();
-
     // --- Entrance
     addEntrance(m_shop1EntranceMesh.vertices, x, z, w, uvScale);
-    m_shop1EntranceMesh.setup();
 }
 
 void StreetMap::initShop2() {
@@ -307,7 +296,6 @@ void StreetMap::initShop2() {
 
     // --- Base
     addCube(m_shop2BaseMesh.vertices, x, 0.0001f, z, w, h, d, uvScale);
-    m_shop2BaseMesh.setup();
 
     float overhang = 0.3f;
 
@@ -322,11 +310,8 @@ void StreetMap::initShop2() {
         uvScale
     );
 
-    m_shop2RoofMesh.setup();
-
     // --- Entrance
     addEntrance(m_shop2EntranceMesh.vertices, x, z, w, uvScale);
-    m_shop2EntranceMesh.setup();
 }
 
 void StreetMap::initShop3() {
@@ -348,9 +333,6 @@ void StreetMap::initShop3() {
         8
     );
 
-    m_awningEvenMesh.setup();
-    m_awningOddMesh.setup();
-
     float x = m_roadOuter - 8.5f;
     float z = m_roadOuter + 2.5f;
 
@@ -365,11 +347,8 @@ void StreetMap::initShop3() {
         uvScale
     );
 
-    m_shop3BaseMesh.setup();
-
     // --- Entrance
     addEntrance(m_shop3EntranceMesh.vertices, x, z, h, uvScale);
-    m_shop3EntranceMesh.setup();
 
     float winW = 1.5f;
     float winH = 1.5f;
@@ -400,7 +379,6 @@ void StreetMap::initShop4() {
     
     // --- Base
     addCube(m_shop4BaseMesh.vertices, x, y, z, w, h, d, 0.35f);
-    m_shop4BaseMesh.setup();
 
     // --- Roof
     float overhang = 0.2f;
@@ -416,11 +394,8 @@ void StreetMap::initShop4() {
         uvScale
     );
 
-    m_shop4RoofMesh.setup();
-
     // --- Entrance
     addEntrance(m_shop4EntranceMesh.vertices, x, z, h, uvScale);
-    m_shop4EntranceMesh.setup();
 }
 
 void StreetMap::initShop5() {
@@ -437,7 +412,6 @@ void StreetMap::initShop5() {
 
     // --- Base
     addCube(m_shop5BaseMesh.vertices, x, y, z, w, h, d, uvScale);
-    m_shop5BaseMesh.setup();
 
     // --- Roof
     float overhang = 0.2f;
@@ -452,11 +426,8 @@ void StreetMap::initShop5() {
         uvScale
     );
 
-    m_shop5RoofMesh.setup();
-
     // --- Entrance
     addEntrance(m_shop5EntranceMesh.vertices, x, z, h, uvScale);
-    m_shop5EntranceMesh.setup();
 }
 
 void StreetMap::addEntrance(std::vector<float>& v, float x, float z, float h, float uvScale) {
@@ -511,124 +482,129 @@ void StreetMap::addEntrance(std::vector<float>& v, float x, float z, float h, fl
     );
 }
 
-void StreetMap::drawLitObjects(Shader& shader) {
-    glm::mat4 model = glm::mat4(1.0f);
+void StreetMap::initStaticBatches() {
+    const float MATTE = 4.0f;
+    const float BUILDING = 16.0f;
+    glm::vec3 white(1.0f);
+
+    // The transforms each mesh used to be drawn with, baked into the batches
+    glm::mat4 curbModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.15f, 0.0f)); // Raise a bit
+    glm::mat4 groundModel = glm::translate(curbModel, glm::vec3(0.0f, -0.05f, 0.0f));
+
+    glm::mat4 awningModel = glm::rotate(groundModel, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    awningModel = glm::translate(awningModel, glm::vec3(-3.5f, -0.55f, -23.0f));
+
+    glm::mat4 shop4BaseModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, 0.1f, 0.5f));
+    glm::mat4 shop4RoofModel = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    shop4RoofModel = glm::translate(shop4RoofModel, glm::vec3(0.5f, 0.0f, -2.5f));
+
+    glm::mat4 shop5BaseModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, 0.0f, 3.0f));
+    glm::mat4 shop5RoofModel = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    shop5RoofModel = glm::translate(shop5RoofModel, glm::vec3(3.0f, 0.0f, -2.5f));
+
+    // Road, curbs and sidewalks
+    staticBatch(m_roadTexture, MATTE).add(m_roadMesh, glm::mat4(1.0f), white);
 
+    StaticBatch& curbs = staticBatch(m_curbTexture, MATTE);
+    curbs.add(m_innerCurbMesh, curbModel, glm::vec3(0.7f, 0.7f, 0.69f));
+    curbs.add(m_outerCurbMesh, curbModel, glm::vec3(0.7f, 0.7f, 0.69f));
+
+    StaticBatch& sidewalks = staticBatch(m_sidewalkTexture, MATTE);
+    sidewalks.add(m_innerSidewalkMesh, groundModel, white);
+    sidewalks.add(m_outerSidewalkMesh, groundModel, white);
+
+    // Shop 1
+    StaticBatch& shop1 = staticBatch(m_shop1Texture, BUILDING);
+    shop1.add(m_shop1BaseMesh, groundModel, glm::vec3(0.80f, 0.45f, 0.40f));
+    shop1.add(m_shop1RoofMesh, groundModel, glm::vec3(0.50f, 0.20f, 0.15f));
+    shop1.add(m_shop1EntranceMesh, groundModel, glm::vec3(0.50f, 0.20f, 0.15f));
+
+    // Shop 2
+    StaticBatch& shop2 = staticBatch(m_shop2BaseTexture, BUILDING);
+    shop2.add(m_shop2BaseMesh, groundModel, glm::vec3(0.75f, 0.55f, 0.35f));
+    shop2.add(m_shop2EntranceMesh, groundModel, glm::vec3(0.55f, 0.35f, 0.15f));
+    staticBatch(m_shop2RoofTexture, BUILDING).add(m_shop2RoofMesh, groundModel, white);
+
+    // Shop 3
+    StaticBatch& shop3 = staticBatch(m_shop3Texture, BUILDING);
+    shop3.add(m_shop3BaseMesh, groundModel, glm::vec3(0.57f, 0.42f, 0.01f));
+    shop3.add(m_shop3EntranceMesh, groundModel, glm::vec3(0.36f, 0.31f, 0.31f));
+    shop3.add(m_awningEvenMesh, awningModel, glm::vec3(0.36f, 0.31f, 0.31f));
+    shop3.add(m_awningOddMesh, awningModel, glm::vec3(0.95f, 0.95f, 0.95f));
+
+    // Shops 4 and 5 (the base of the fifth shares the fourth's concrete)
+    StaticBatch& shop4 = staticBatch(m_shop4BaseTexture, BUILDING);
+    shop4.add(m_shop4BaseMesh, shop4BaseModel, glm::vec3(0.43f, 0.53f, 0.62f));
+    shop4.add(m_shop4RoofMesh, shop4RoofModel, glm::vec3(0.33f, 0.43f, 0.52f));
+    shop4.add(m_shop4EntranceMesh, shop4RoofModel, glm::vec3(0.33f, 0.43f, 0.52f));
+    shop4.add(m_shop5BaseMesh, shop5BaseModel, glm::vec3(0.42f, 0.43f, 0.42f));
+
+    StaticBatch& shop5 = staticBatch(m_shop5RoofTexture, BUILDING);
+    shop5.add(m_shop5RoofMesh, shop5RoofModel, glm::vec3(0.42f, 0.43f, 0.42f));
+    shop5.add(m_shop5EntranceMesh, shop5RoofModel, glm::vec3(0.42f, 0.43f, 0.42f));
+
+    for (auto& material : m_staticBatches) {
+        material.batch.setup();
+    }
+}
+
+StaticBatch& StreetMap::staticBatch(GLuint texture, float shininess) {
+    for (auto& material : m_staticBatches) {
+        if (material.texture == texture && material.shininess == shininess) {
+            return material.batch;
+        }
+    }
+
+    m_staticBatches.push_back({ texture, shininess, StaticBatch() });
+    return m_staticBatches.back().batch;
+}
+
+void StreetMap::drawLitObjects(Shader& shader) {
     // Matte surfaces (specular = 0)
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, m_blackTexture); 
     shader.setInt("material.specular", 1);
-    shader.setFloat("material.shininess", 4.0f);
+    shader.setInt("material.diffuse", 0);
 
-    // Draw road
+    // Static geometry is already in world space and carries its own color
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_roadTexture);
-    shader.setInt("material.diffuse", 0);
-    shader.setVec3("objectColor", glm::vec3(1.0f, 1.0f, 1.0f));
-    shader.setMat4("model", model);
-    m_roadMesh.draw();
-
-    // Draw curbs
-    glBindTexture(GL_TEXTURE_2D, m_curbTexture);
-    model = glm::translate(model, glm::vec3(0.0f, 0.15f, 0.0f)); // Raise a bit
-    shader.setMat4("model", model);
-    shader.setVec3("objectColor", glm::vec3(0.7f, 0.7f, 0.69f));
-    m_innerCurbMesh.draw();    
-    m_outerCurbMesh.draw();
-
-    // Draw sidewalks
-    glBindTexture(GL_TEXTURE_2D, m_sidewalkTexture);
-    model = glm::translate(model, glm::vec3(0.0f, -0.05f, 0.0f));
-    shader.setMat4("model", model);
+    shader.setMat4("model", glm::mat4(1.0f));
     shader.setVec3("objectColor", glm::vec3(1.0f, 1.0f, 1.0f));
-    m_innerSidewalkMesh.draw();
-    m_outerSidewalkMesh.draw();
 
-    // -- Buildings
-    shader.setFloat("material.shininess", 16.0f);
+    for (auto& material : m_staticBatches) {
+        glBindTexture(GL_TEXTURE_2D, material.texture);
+        shader.setFloat("material.shininess", material.shininess);
+        material.batch.draw();
+    }
 
-    // Shop 1
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_shop1Texture);
-    shader.setVec3("objectColor", glm::vec3(0.80f, 0.45f, 0.40f));
-    m_shop1BaseMesh.draw();
-    shader.setVec3("objectColor", glm::vec3(0.50f, 0.20f, 0.15f));
-    m_shop1RoofMesh.draw();
-    m_shop1EntranceMesh.draw();
+    drawFurniture(shader);
+}
 
-    // Shop 2
-    glBindTexture(GL_TEXTURE_2D, m_shop2BaseTexture);
-    shader.setVec3("objectColor", glm::vec3(0.75f, 0.55f, 0.35f));
-    m_shop2BaseMesh.draw();
-    shader.setVec3("objectColor", glm::vec3(0.55f, 0.35f, 0.15f));
-    m_shop2EntranceMesh.draw();
-    glBindTexture(GL_TEXTURE_2D, m_shop2RoofTexture);
-    shader.setVec3("objectColor", glm::vec3(1.0f));
-    m_shop2RoofMesh.draw();
-    
-    // Shop 3
-    glBindTexture(GL_TEXTURE_2D, m_shop3Texture);
-    shader.setVec3("objectColor", glm::vec3(0.57f, 0.42f, 0.01f));
-    m_shop3BaseMesh.draw();
-    shader.setVec3("objectColor", glm::vec3(0.36f, 0.31f, 0.31f)); 
-    m_shop3EntranceMesh.draw();
-    
-    model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    model = glm::translate(model, glm::vec3(-3.5f, -0.55f, -23.0f));
-    shader.setMat4("model", model);
-    m_awningEvenMesh.draw();
-    shader.setVec3("objectColor", glm::vec3(0.95f, 0.95f, 0.95f));
-    m_awningOddMesh.draw();
-
-    // Shop 4
-    glBindTexture(GL_TEXTURE_2D, m_shop4BaseTexture);
-    model = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, 0.1f, 0.5f));
-    shader.setVec3("objectColor", glm::vec3(0.43f, 0.53f, 0.62f));
-    shader.setMat4("model", model);
-    m_shop4BaseMesh.draw();
-    shader.setVec3("objectColor", glm::vec3(0.33f, 0.43f, 0.52f));
-    model = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    model = glm::translate(model, glm::vec3(0.5f, 0.0f, -2.5f));
-    shader.setMat4("model", model);
-    m_shop4RoofMesh.draw();
-    m_shop4EntranceMesh.draw();
-
-    // Shop 5
-    model = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, 0.0f, 3.0f));
-    shader.setMat4("model", model);
-    shader.setVec3("objectColor", glm::vec3(0.42f, 0.43f, 0.42f));
-    m_shop5BaseMesh.draw();
-    glBindTexture(GL_TEXTURE_2D, m_shop5RoofTexture);
-    model = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    model = glm::translate(model, glm::vec3(3.0f, 0.0f, -2.5f));
-    shader.setMat4("model", model);
-    m_shop5RoofMesh.draw();
-    m_shop5EntranceMesh.draw();
+void StreetMap::drawShadowCasters(Shader& shader) {
+    shader.setMat4("model", glm::mat4(1.0f));
+    for (auto& material : m_staticBatches) {
+        material.batch.draw();
+    }
+
+    drawFurniture(shader);
+}
+
+void StreetMap::drawFurniture(Shader& shader) {
+    // Instances carry their own transforms
+    shader.setMat4("model", glm::mat4(1.0f));
 
     // -- Metal
     shader.setFloat("material.shininess", 64.0f);
     glActiveTexture(GL_TEXTURE0); // Switch back to diffuse unit
-    shader.setVec3("objectColor", glm::vec3(0.2f, 0.2f, 0.2f)); // Dark Grey
+    glBindTexture(GL_TEXTURE_2D, m_shop5RoofTexture); // What the metal has always been drawn with
 
     // Lamp poles
-    for (const auto& pos : m_lampPositions) {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, pos); 
-        shader.setMat4("model", model);
-        
-        m_lampPoleMesh.draw();
-    }
+    shader.setVec3("objectColor", glm::vec3(0.2f, 0.2f, 0.2f)); // Dark Grey
+    m_lampPoleMesh.drawInstanced();
 
     // Metal bench legs
-    for (const auto& bench : m_benches) {
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, bench.position);
-        model = glm::rotate(model, glm::radians(bench.rotation), glm::vec3(0.0f, 1.0f, 0.0f));
-        shader.setMat4("model", model);
-
-        shader.setVec3("objectColor", glm::vec3(0.3f, 0.3f, 0.35f)); 
-        m_benchMetalMesh.draw();
-    }
+    shader.setVec3("objectColor", glm::vec3(0.3f, 0.3f, 0.35f)); 
+    m_benchMetalMesh.drawInstanced();
 
     // Matte surfaces (specular = 0)
     glActiveTexture(GL_TEXTURE1);
@@ -638,48 +614,40 @@ void StreetMap::drawLitObjects(Shader& shader) {
 
     // Draw benches
     glBindTexture(GL_TEXTURE_2D, m_benchWoodTexture);
-    for (const auto& bench : m_benches) {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, bench.position);
-        model = glm::rotate(model, glm::radians(bench.rotation), glm::vec3(0.0f, 1.0f, 0.0f));
-        shader.setMat4("model", model);
-
-        // Wood parts
-        shader.setVec3("objectColor", glm::vec3(0.6f, 0.4f, 0.2f));
-        m_benchWoodMesh.draw();
-    }
+    shader.setVec3("objectColor", glm::vec3(0.6f, 0.4f, 0.2f));
+    m_benchWoodMesh.drawInstanced();
 }
 
 void StreetMap::drawEmissives(Shader& shader) {
     shader.setVec3("lightColor", glm::vec3(1.0f, 0.9f, 0.7f)); 
-
-    for (size_t i = 0; i < m_lampPositions.size(); ++i) {
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, m_lampPositions[i]);
-        shader.setMat4("model", model);
-        m_lampBulbMesh.draw();
-    }
+    shader.setMat4("model", glm::mat4(1.0f));
+    m_lampBulbMesh.drawInstanced();
 }
 
-void StreetMap::applyLightningState(Shader& shader) {
-    shader.setVec3("dirLight.direction", glm::vec3(-0.2f, -1.0f, -0.3f)); 
-    shader.setVec3("dirLight.ambient",  glm::vec3(0.03f, 0.03f, 0.07f));
-    shader.setVec3("dirLight.diffuse",  glm::vec3(0.15f, 0.15f, 0.2f));
-    shader.setVec3("dirLight.specular", glm::vec3(0.1f, 0.1f, 0.1f));
+void StreetMap::applyLightningState() {
+    LightsBlock lights{}; // Zeroed padding, so unchanged lights compare equal to the last upload
 
-    for (int i = 0; i < m_lampPositions.size(); ++i) {
-        std::string index = std::to_string(i);
+    lights.dirLight.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+    lights.dirLight.ambient   = glm::vec3(0.03f, 0.03f, 0.07f);
+    lights.dirLight.diffuse   = glm::vec3(0.15f, 0.15f, 0.2f);
+    lights.dirLight.specular  = glm::vec3(0.1f, 0.1f, 0.1f);
+
+    lights.numLights = static_cast<int>(std::min(m_lampPositions.size(), size_t(MAX_POINT_LIGHTS)));
+    for (int i = 0; i < lights.numLights; ++i) {
+        PointLightBlock& light = lights.pointLights[i];
         glm::vec3 bulbOffset(0.0f, 2.2f, 0.0f); // Bulb height in model space
-        shader.setVec3("pointLights[" + index + "].position", m_lampPositions[i] + bulbOffset);
-        
-        shader.setVec3("pointLights[" + index + "].ambient",  glm::vec3(0.07f, 0.07f, 0.07f));
-        shader.setVec3("pointLights[" + index + "].diffuse",  glm::vec3(0.8f)); 
-        shader.setVec3("pointLights[" + index + "].specular", glm::vec3(0.2f));
+        light.position = m_lampPositions[i] + bulbOffset;
+
+        light.ambient  = glm::vec3(0.07f, 0.07f, 0.07f);
+        light.diffuse  = glm::vec3(0.8f); 
+        light.specular = glm::vec3(0.2f);
 
-        shader.setFloat("pointLights[" + index + "].constant", 1.0f);
-        shader.setFloat("pointLights[" + index + "].linear", 0.07f);
-        shader.setFloat("pointLights[" + index + "].quadratic", 0.08f);
+        light.constant  = 1.0f;
+        light.linear    = 0.07f;
+        light.quadratic = 0.08f;
     }
+
+    m_lightsBuffer.update(&lights);
 }
 
 void StreetMap::addRectangle(std::vector<float>& vec, float x1, float z1, float x2, float z2, float x3, float z3, float x4, float z4, float uMax, float vMax) {
@@ -734,28 +702,11 @@ void StreetMap::addWall(std::vector<float>& v, float x1, float z1, float x2, flo
 }
 
 void StreetMap::cleanup() {
-    m_roadMesh.destroy();
-    m_innerCurbMesh.destroy();
-    m_outerCurbMesh.destroy();
-    m_innerSidewalkMesh.destroy();
-    m_outerSidewalkMesh.destroy();
-    m_shop1BaseMesh.destroy();
-    m_shop1RoofMesh.destroy();
-    m_shop1EntranceMesh.destroy();
-    m_shop2BaseMesh.destroy();
-    m_shop2RoofMesh.destroy();
-    m_shop2EntranceMesh.destroy();
-    m_shop3BaseMesh.destroy();
-    m_shop3EntranceMesh.destroy();
-    m_awningEvenMesh.destroy();
-    m_awningOddMesh.destroy();
+    m_lightsBuffer.destroy();
+    for (auto& material : m_staticBatches) {
+        material.batch.destroy();
+    }
     m_glowingWindowMesh.destroy();
-    m_shop4BaseMesh.destroy();
-    m_shop4RoofMesh.destroy();
-    m_shop4EntranceMesh.destroy();
-    m_shop5BaseMesh.destroy();
-    m_shop5RoofMesh.destroy();
-    m_shop5EntranceMesh.destroy();
     m_benchWoodMesh.destroy();
     m_benchMetalMesh.destroy();
     m_lampPoleMesh.destroy();
@@ -951,7 +902,6 @@ void StreetMap::initBenchModel() {
     // Right
     addCube(m_benchMetalMesh.vertices, 0.6f, 0.45f, 0.0f, legWidth, 0.5f, 0.05f, 1.0f);
 
-
     // --- Wood planks
     float startX = -(width - legWidth) / 2.0f; // Center the planks on X
 
@@ -979,6 +929,17 @@ void StreetMap::initBenches() {
     m_benches.push_back({ glm::vec3(10.5f, 0.10f, 6.0f), -90.0f });
     m_benches.push_back({ glm::vec3(4.5f, 0.10f, 1.5f), 90.0f });
     m_benches.push_back({ glm::vec3(4.5f, 0.10f, 4.0f), 90.0f });
+
+    std::vector<glm::mat4> transforms;
+    for (const auto& bench : m_benches) {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, bench.position);
+        model = glm::rotate(model, glm::radians(bench.rotation), glm::vec3(0.0f, 1.0f, 0.0f));
+        transforms.push_back(model);
+    }
+
+    m_benchMetalMesh.setInstances(transforms);
+    m_benchWoodMesh.setInstances(transforms);
 }
 
 void StreetMap::addStripedAwning(
@@ -1049,7 +1010,6 @@ void StreetMap::initLampModel() {
     float capWidth = 0.5f;
     addPrism(m_lampPoleMesh.vertices, -capWidth/2, poleHeight + 0.5f, -capWidth/2, capWidth, 0.15f, capWidth, 1.0f);
 
-
     // --- The bulb
     float bulbSize = 0.30f;
     addCube(m_lampBulbMesh.vertices, -bulbSize/2, poleHeight, -bulbSize/2, bulbSize, 0.5f, bulbSize, 1.0f);
@@ -1066,4 +1026,12 @@ void StreetMap::initLamps() {
     m_lampPositions.push_back(glm::vec3(10.0f, 0.10f, 3.8f));
     m_lampPositions.push_back(glm::vec3(10.0f, 0.10f, 9.0f));
     m_lampPositions.push_back(glm::vec3(1.0f, 0.10f, 10.0f));
+
+    std::vector<glm::mat4> transforms;
+    for (const auto& pos : m_lampPositions) {
+        transforms.push_back(glm::translate(glm::mat4(1.0f), pos));
+    }
+
+    m_lampPoleMesh.setInstances(transforms);
+    m_lampBulbMesh.setInstances(transforms);
 }
\ No newline at end of file
@@ -0,0 +1,40 @@
+#include "UniformBuffer.hpp"
+
+#include <algorithm>
+
+void UniformBuffer::setup(GLuint bindingPoint, size_t size) {
+    glGenBuffers(1, &m_bufferID);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_bufferID);
+    glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, m_bufferID);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    m_uploaded.assign(size, 0);
+    m_empty = true;
+}
+
+void UniformBuffer::update(const void* data) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    size_t size = m_uploaded.size();
+
+    // Range of bytes that differ from the buffer's contents
+    size_t first = 0;
+    size_t last = size;
+    if (!m_empty) {
+        while (first < size && bytes[first] == m_uploaded[first]) ++first;
+        if (first == size) return;
+        while (bytes[last - 1] == m_uploaded[last - 1]) --last;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_bufferID);
+    glBufferSubData(GL_UNIFORM_BUFFER, first, last - first, bytes + first);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    std::copy(bytes + first, bytes + last, m_uploaded.begin() + first);
+    m_empty = false;
+}
+
+void UniformBuffer::destroy() {
+    glDeleteBuffers(1, &m_bufferID);
+    m_bufferID = 0;
+}
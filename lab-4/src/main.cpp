@@ -9,6 +9,7 @@
 #include "Camera.hpp"
 #include "Shader.hpp"
 #include "StreetMap.hpp"
+#include "UniformBuffer.hpp"
 
 #include <iostream>
 
@@ -125,6 +126,19 @@ int main() {
     Shader lampShader("./shaders/lamp.vs", "./shaders/lamp.fs");
     Shader shadowShader("./shaders/shadow.vs", "./shaders/shadow.fs");
 
+    // Per-frame camera data and the lights live in uniform blocks all programs share
+    UniformBuffer cameraBuffer;
+    cameraBuffer.setup(CAMERA_BLOCK_BINDING, sizeof(CameraBlock));
+
+    for (Shader* shader : { &mainShader, &lampShader, &shadowShader }) {
+        shader->bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+        shader->bindUniformBlock("Lights", LIGHTS_BLOCK_BINDING);
+    }
+
+    // Uniforms set every frame
+    auto mainShadowMap   = mainShader.uniform<int>("shadowMap");
+    auto mainObjectColor = mainShader.uniform<glm::vec3>("objectColor");
+
     StreetMap street;
     street.init();
 
@@ -189,20 +203,38 @@ int main() {
         glm::mat4 lightView = glm::lookAt(glm::vec3(5.0f, 15.0f, 5.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
         glm::mat4 lightSpaceMatrix = lightProjection * lightView;
 
+        int currentWidth, currentHeight;
+        glfwGetFramebufferSize(window, &currentWidth, &currentHeight);
+
+        // Dynamic aspect ratio
+        if (currentHeight == 0) currentHeight = 1;
+
+        glm::mat4 projection = glm::perspective(
+            glm::radians(camera.getZoom()), 
+            static_cast<float>(currentWidth) / static_cast<float>(currentHeight), // Aspect ratio
+            0.1f, 
+            100.0f
+        );
+
+        CameraBlock cameraBlock{};
+        cameraBlock.view = camera.getViewMatrix();
+        cameraBlock.projection = projection;
+        cameraBlock.lightSpaceMatrix = lightSpaceMatrix;
+        cameraBlock.viewPos = camera.getPosition();
+        cameraBuffer.update(&cameraBlock);
+
+        street.applyLightningState();
+
         // Render Depth
         shadowShader.use();
-        shadowShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
 
         glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
         glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
         glClear(GL_DEPTH_BUFFER_BIT);
         // Draw everything that casts shadows
-        street.drawLitObjects(shadowShader); 
+        street.drawShadowCasters(shadowShader);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        int currentWidth, currentHeight;
-        glfwGetFramebufferSize(window, &currentWidth, &currentHeight);
-
         // Reset Viewport for normal render
         glViewport(0, 0, currentWidth, currentHeight);
 
@@ -212,34 +244,14 @@ int main() {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
         mainShader.use();
-        mainShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
         glActiveTexture(GL_TEXTURE2);
         glBindTexture(GL_TEXTURE_2D, depthMap);
-        mainShader.setInt("shadowMap", 2);
-        mainShader.setVec3("viewPos", camera.getPosition());
-        mainShader.setVec3("objectColor", glm::vec3(1.0f, 1.0f, 1.0f));
-        mainShader.setInt("numLights", static_cast<int>(street.m_lampPositions.size()));
-        
-        // Dynamic aspect ratio
-        if (currentHeight == 0) currentHeight = 1;
+        mainShader.set(mainShadowMap, 2);
+        mainShader.set(mainObjectColor, glm::vec3(1.0f, 1.0f, 1.0f));
 
-        mainShader.setMat4("view", camera.getViewMatrix());
-        
-        glm::mat4 projection = glm::perspective(
-            glm::radians(camera.getZoom()), 
-            static_cast<float>(currentWidth) / static_cast<float>(currentHeight), // Aspect ratio
-            0.1f, 
-            100.0f
-        );
-        mainShader.setMat4("projection", projection);
-
-        street.applyLightningState(mainShader);
         street.drawLitObjects(mainShader);
 
         lampShader.use();
-        lampShader.setMat4("projection", projection);
-        lampShader.setMat4("view", camera.getViewMatrix());
-
         street.drawEmissives(lampShader);
 
         // Check and call events and swap buffers
@@ -248,6 +260,7 @@ int main() {
     }
 
     std::cout << std::endl;
+    cameraBuffer.destroy();
     street.cleanup();
     glfwTerminate();
     return 0;
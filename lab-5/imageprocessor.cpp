@@ -1,97 +1,162 @@
 #include "imageprocessor.h"
+#include "rowbands.h"
+
 #include <QDebug>
 
+#include <atomic>
+#include <cmath>
+
 ImageProcessor::ImageProcessor() = default;
 
-QImage ImageProcessor::applyTransformations(const QImage& src, int brightness, int contrast, bool isGray, bool isNegative) {
-    if (src.isNull()) return QImage();
+std::mutex ImageProcessor::statsMutex;
+qint64 ImageProcessor::statsKey = 0;
+ImageProcessor::ChannelSums ImageProcessor::statsCache;
 
-    QImage result = src;
+QImage ImageProcessor::applyTransformations(const QImage& src, int brightness, int contrast, bool isGray, bool isNegative) {
+    PointOperations ops;
+    ops.grayscale = isGray;
+    ops.negative = isNegative;
+    ops.brightness = brightness;
+    ops.contrast = contrast;
 
-    // Apply grayscale and/or negative
-    if (isGray || isNegative) applyGrayscaleAndNegative(result, isGray, isNegative);
+    return applyPointOperations(src, ops);
+}
 
-    int width      = result.width();
-    int height     = result.height();
-    int pixelCount = width * height;
+QImage ImageProcessor::applyPointOperations(const QImage& src, const PointOperations& ops) {
+    if (src.isNull()) return QImage();
 
-    size_t sumR = 0, sumG = 0, sumB = 0;
+    QImage source = src.convertToFormat(QImage::Format_ARGB32);
 
-    for (int y = 0; y < height; ++y) {
-        QRgb *row = reinterpret_cast<QRgb*>(result.scanLine(y));
+    int width      = source.width();
+    int height     = source.height();
+    size_t pixelCount = size_t(width) * height;
 
-        for (int x = 0; x < width; ++x) {
-            QRgb p = row[x];
-            sumR += qRed(p);
-            sumG += qGreen(p);
-            sumB += qBlue(p);
-        }
+    // Means after grayscale and negative follow from the sums of the source:
+    // every channel of a gray pixel is its luminance, and negation maps the sum S to 255 * n - S
+    ChannelSums sums = channelSums(source);
+    size_t channelSum[3] = { sums.red, sums.green, sums.blue };
+    if (ops.grayscale) {
+        channelSum[0] = channelSum[1] = channelSum[2] = sums.gray;
     }
 
-    double avgR = sumR / static_cast<double>(pixelCount);
-    double avgG = sumG / static_cast<double>(pixelCount);
-    double avgB = sumB / static_cast<double>(pixelCount);
-
-    double t = (contrast - 5000) / 5000.0f;
+    double t = (ops.contrast - 5000) / 5000.0f;
     double K = std::pow(2.0, t * 2.0);
 
     // Brightness offset
-    double shift = static_cast<double>(brightness);
+    double shift = static_cast<double>(ops.brightness);
 
-    // Lookup tables
-    uchar lutR[256];
-    uchar lutG[256];
-    uchar lutB[256];
+    // Lookup tables of the whole chain, indexed by source values (by luminance in grayscale mode)
+    uchar lut[3][256];
 
-    // Y = K * (Y_old - Y_av) + Y_av + Brightness
-    for (int i = 0; i < 256; ++i) {
-        lutR[i] = static_cast<uchar>(std::clamp(K * (i - avgR) + avgR + shift, 0.0, 255.0)); // Red
-        lutG[i] = static_cast<uchar>(std::clamp(K * (i - avgG) + avgG + shift, 0.0, 255.0)); // Green
-        lutB[i] = static_cast<uchar>(std::clamp(K * (i - avgB) + avgB + shift, 0.0, 255.0)); // Blue
+    for (int c = 0; c < 3; ++c) {
+        size_t sum = ops.negative ? 255 * pixelCount - channelSum[c] : channelSum[c];
+        double avg = sum / static_cast<double>(pixelCount);
+
+        // Y = K * (Y_old - Y_av) + Y_av + Brightness
+        for (int i = 0; i < 256; ++i) {
+            int value = ops.negative ? 255 - i : i;
+            lut[c][i] = static_cast<uchar>(std::clamp(K * (value - avg) + avg + shift, 0.0, 255.0));
+        }
     }
 
-    // Write to the result image
-    for (int y = 0; y < height; ++y) {
-        QRgb *row = reinterpret_cast<QRgb*>(result.scanLine(y));
-
-        for (int x = 0; x < width; ++x) {
-            QRgb p = row[x];
-            row[x] = qRgb(
-                lutR[qRed(p)],
-                lutG[qGreen(p)],
-                lutB[qBlue(p)]
-            );
+    bool binarize = ops.threshold >= 0 && ops.threshold <= 255;
+
+    // A gray pixel converts to Grayscale8 as its own value, so in grayscale mode the
+    // threshold is one more step of the table and the whole chain stays a single pass
+    if (ops.grayscale && binarize) {
+        for (int i = 0; i < 256; ++i) {
+            lut[0][i] = lut[0][i] >= ops.threshold ? 255 : 0;
         }
     }
 
+    QImage result(width, height, QImage::Format_ARGB32);
+    uchar* resultBits = result.bits();
+    qsizetype resultStride = result.bytesPerLine();
+
+    RowBands::run(height, source.bytesPerLine(), 0, [&](int yBegin, int yEnd) {
+        for (int y = yBegin; y < yEnd; ++y) {
+            const QRgb *row = reinterpret_cast<const QRgb*>(source.constScanLine(y));
+            QRgb *dstRow = reinterpret_cast<QRgb*>(resultBits + y * resultStride);
+
+            if (ops.grayscale) {
+                for (int x = 0; x < width; ++x) {
+                    int v = lut[0][qGray(row[x])];
+                    dstRow[x] = qRgb(v, v, v);
+                }
+            } else {
+                for (int x = 0; x < width; ++x) {
+                    QRgb p = row[x];
+                    dstRow[x] = qRgb(
+                        lut[0][qRed(p)],
+                        lut[1][qGreen(p)],
+                        lut[2][qBlue(p)]
+                    );
+                }
+            }
+        }
+    });
+
+    if (!binarize || ops.grayscale) return result;
+
+    // Colour output is thresholded on Qt's Grayscale8 conversion, as binarizeManual does: it is
+    // colour-space aware, so saturated colours don't land where qGray would put them
+    QImage gray = result.convertToFormat(QImage::Format_Grayscale8);
+
+    RowBands::run(height, resultStride, 0, [&](int yBegin, int yEnd) {
+        for (int y = yBegin; y < yEnd; ++y) {
+            const uchar *row = gray.constScanLine(y);
+            QRgb *dstRow = reinterpret_cast<QRgb*>(resultBits + y * resultStride);
+
+            for (int x = 0; x < width; ++x) {
+                dstRow[x] = row[x] >= ops.threshold ? qRgb(255, 255, 255) : qRgb(0, 0, 0);
+            }
+        }
+    });
+
     return result;
 }
 
-void ImageProcessor::applyGrayscaleAndNegative(QImage& img, bool isGray, bool isNegative) {
-    for (int y = 0; y < img.height(); ++y) {
-        QRgb *row = reinterpret_cast<QRgb*>(img.scanLine(y));
+ImageProcessor::ChannelSums ImageProcessor::channelSums(const QImage& src) {
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        if (statsKey == src.cacheKey()) return statsCache;
+    }
 
-        for (int x = 0; x < img.width(); ++x) {
-            QRgb p = row[x];
+    int width = src.width();
+    std::atomic<size_t> sumR{0}, sumG{0}, sumB{0}, sumGray{0};
 
-            int r = qRed(p);
-            int g = qGreen(p);
-            int b = qBlue(p);
+    RowBands::run(src.height(), src.bytesPerLine(), 0, [&](int yBegin, int yEnd) {
+        size_t bandR = 0, bandG = 0, bandB = 0, bandGray = 0;
 
-            if (isGray) {
-                int y = qGray(p);
-                r = g = b = y;
-            }
+        for (int y = yBegin; y < yEnd; ++y) {
+            const QRgb *row = reinterpret_cast<const QRgb*>(src.constScanLine(y));
 
-            if (isNegative) {
-                r = 255 - r;
-                g = 255 - g;
-                b = 255 - b;
+            for (int x = 0; x < width; ++x) {
+                QRgb p = row[x];
+                bandR += qRed(p);
+                bandG += qGreen(p);
+                bandB += qBlue(p);
+                bandGray += qGray(p);
             }
-
-            row[x] = qRgb(r, g, b);
         }
-    }
+
+        sumR += bandR;
+        sumG += bandG;
+        sumB += bandB;
+        sumGray += bandGray;
+    });
+
+    ChannelSums sums;
+    sums.red = sumR;
+    sums.green = sumG;
+    sums.blue = sumB;
+    sums.gray = sumGray;
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    statsKey = src.cacheKey();
+    statsCache = sums;
+
+    return sums;
 }
 
 std::vector<int> ImageProcessor::calculateHistogram(const QImage& src) {
@@ -183,59 +248,138 @@ QImage ImageProcessor::binarizeOtsu(const QImage& src) {
     return result;
 }
 
-QImage ImageProcessor::binarizeAdaptive(const QImage& src) {
+QImage ImageProcessor::binarizeAdaptive(const QImage& src, const AdaptiveThreshold& params) {
     if (src.isNull()) return QImage();
 
-    QImage source = src.convertToFormat(QImage::Format_RGB32);
-    QImage result = source;
-
-    int w = source.width();
-    int h = source.height();
+    IntegralImage integral = buildIntegralImage(src);
 
-    int blockSize = 11;
-    int C = 2;
+    int w = integral.width;
+    int h = integral.height;
 
+    int blockSize = std::clamp(params.blockSize | 1, 3, 255);
     int halfBlock = blockSize / 2;
 
-    // Iterate every pixel
-    for (int y = 0; y < h; ++y) {
-        const QRgb *srcRow = reinterpret_cast<const QRgb*>(source.constScanLine(y));
-        QRgb *dstRow = reinterpret_cast<QRgb*>(result.scanLine(y));
+    // Gaussian weights are approximated by averaging nested boxes of growing size,
+    // which gives a stepped bell-shaped kernel with sigma of about 0.4 * halfBlock
+    constexpr int GAUSSIAN_LEVELS = 4;
+    int levelRadius[GAUSSIAN_LEVELS];
+    for (int i = 0; i < GAUSSIAN_LEVELS; ++i) {
+        levelRadius[i] = (halfBlock * (i + 1) + GAUSSIAN_LEVELS / 2) / GAUSSIAN_LEVELS;
+    }
 
-        for (int x = 0; x < w; ++x) {
-            //  Calculate Local Mean
-            int sum = 0;
-            int count = 0;
+    constexpr double SAUVOLA_RANGE = 128.0; // Dynamic range of the standard deviation
 
-            // Loop over the neighbor block
-            for (int dy = -halfBlock; dy <= halfBlock; ++dy) {
-                int ny = y + dy;
-                // Boundary check Y
-                if (ny < 0 || ny >= h) continue;
+    QImage result(w, h, QImage::Format_RGB32);
+    uchar* resultBits = result.bits();
+    qsizetype resultStride = result.bytesPerLine();
+
+    // Window around a pixel clipped to the image, means are taken over the pixels inside it
+    struct Window {
+        int x0, y0, x1, y1;
+        int count() const { return (x1 - x0) * (y1 - y0); }
+    };
+
+    auto window = [&](int x, int y, int radius) {
+        return Window{ std::max(x - radius, 0), std::max(y - radius, 0),
+                       std::min(x + radius + 1, w), std::min(y + radius + 1, h) };
+    };
+
+    auto sum = [&](const std::vector<uint32_t>& table, const Window& box) {
+        return integral.boxSum(table, box.x0, box.y0, box.x1, box.y1);
+    };
+
+    RowBands::run(h, qsizetype(w) * sizeof(uint32_t) * 2, halfBlock, [&](int yBegin, int yEnd) {
+        for (int y = yBegin; y < yEnd; ++y) {
+            const uint8_t* lumaRow = integral.luma.data() + size_t(y) * w;
+            QRgb *dstRow = reinterpret_cast<QRgb*>(resultBits + y * resultStride);
+
+            for (int x = 0; x < w; ++x) {
+                int pixelVal = lumaRow[x];
+                bool white = false;
+
+                switch (params.method) {
+                case AdaptiveMethod::Mean: {
+                    Window box = window(x, y, halfBlock);
+                    int localMean = int(sum(integral.sum, box) / box.count());
+                    white = pixelVal > localMean - params.C;
+                    break;
+                }
+                case AdaptiveMethod::Gaussian: {
+                    double localMean = 0.0;
+                    for (int radius : levelRadius) {
+                        Window box = window(x, y, radius);
+                        localMean += double(sum(integral.sum, box)) / box.count();
+                    }
+                    localMean /= GAUSSIAN_LEVELS;
+                    white = pixelVal > localMean - params.C;
+                    break;
+                }
+                case AdaptiveMethod::Niblack:
+                case AdaptiveMethod::Sauvola: {
+                    Window box = window(x, y, halfBlock);
+                    double mean = double(sum(integral.sum, box)) / box.count();
+                    double meanSquare = double(sum(integral.squares, box)) / box.count();
+                    double deviation = std::sqrt(std::max(meanSquare - mean * mean, 0.0));
+
+                    double threshold = params.method == AdaptiveMethod::Niblack
+                                           ? mean + params.k * deviation
+                                           : mean * (1.0 + params.k * (deviation / SAUVOLA_RANGE - 1.0));
+                    white = pixelVal > threshold;
+                    break;
+                }
+                }
 
-                const QRgb *neighborRow = reinterpret_cast<const QRgb*>(source.constScanLine(ny));
+                dstRow[x] = white ? qRgb(255, 255, 255) : qRgb(0, 0, 0);
+            }
+        }
+    });
 
-                for (int dx = -halfBlock; dx <= halfBlock; ++dx) {
-                    int nx = x + dx;
-                    // Boundary check X
-                    if (nx < 0 || nx >= w) continue;
+    return result;
+}
 
-                    sum += qGray(neighborRow[nx]);
-                    count++;
-                }
-            }
+ImageProcessor::IntegralImage ImageProcessor::buildIntegralImage(const QImage& src) {
+    QImage source = src.convertToFormat(QImage::Format_RGB32);
 
-            int localMean = sum / count;
-            int pixelVal = qGray(srcRow[x]);
+    IntegralImage integral;
+    integral.width = source.width();
+    integral.height = source.height();
 
-            // Apply Threshold
-            if (pixelVal > (localMean - C)) {
-                dstRow[x] = qRgb(255, 255, 255);
-            } else {
-                dstRow[x] = qRgb(0, 0, 0);
-            }
+    int w = integral.width;
+    int h = integral.height;
+    size_t stride = size_t(w) + 1;
+
+    integral.luma.resize(size_t(w) * h);
+    integral.sum.assign(stride * (h + 1), 0);
+    integral.squares.assign(stride * (h + 1), 0);
+
+    for (int y = 0; y < h; ++y) {
+        const QRgb *srcRow = reinterpret_cast<const QRgb*>(source.constScanLine(y));
+        uint8_t* lumaRow = integral.luma.data() + size_t(y) * w;
+
+        const uint32_t* sumAbove = integral.sum.data() + size_t(y) * stride;
+        const uint32_t* squaresAbove = integral.squares.data() + size_t(y) * stride;
+        uint32_t* sumRow = integral.sum.data() + size_t(y + 1) * stride;
+        uint32_t* squaresRow = integral.squares.data() + size_t(y + 1) * stride;
+
+        // Running sums along the row added to the table row above
+        uint32_t rowSum = 0;
+        uint32_t rowSquares = 0;
+
+        for (int x = 0; x < w; ++x) {
+            uint32_t gray = qGray(srcRow[x]);
+            lumaRow[x] = uint8_t(gray);
+
+            rowSum += gray;
+            rowSquares += gray * gray;
+            sumRow[x + 1] = sumAbove[x + 1] + rowSum;
+            squaresRow[x + 1] = squaresAbove[x + 1] + rowSquares;
         }
     }
 
-    return result;
+    return integral;
+}
+
+uint32_t ImageProcessor::IntegralImage::boxSum(const std::vector<uint32_t>& table, int x0, int y0, int x1, int y1) const {
+    size_t stride = size_t(width) + 1;
+    return table[y1 * stride + x1] - table[y0 * stride + x1] - table[y1 * stride + x0] + table[y0 * stride + x0];
 }
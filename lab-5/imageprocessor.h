@@ -2,8 +2,36 @@
 #define IMAGEPROCESSOR_H
 
 #include <QImage>
+
+#include <cstdint>
+#include <mutex>
 #include <vector>
 
+// Per-pixel operations of the transformation pipeline, applied in declaration order
+struct PointOperations {
+    bool grayscale = false;
+    bool negative = false;
+    int brightness = 0;  // Shift added to every channel
+    int contrast = 5000; // 0..10000, 5000 leaves the contrast unchanged
+    int threshold = -1;  // Binarize the result against it when in [0; 255], same as binarizeManual
+};
+
+// How adaptive binarization computes the local threshold T of a pixel
+enum class AdaptiveMethod {
+    Mean,     // T = mean - C
+    Gaussian, // T = weighted mean - C, the weights fall off from the center
+    Niblack,  // T = mean + k * stddev
+    Sauvola   // T = mean * (1 + k * (stddev / 128 - 1))
+};
+
+// Parameters of adaptive binarization
+struct AdaptiveThreshold {
+    AdaptiveMethod method = AdaptiveMethod::Mean;
+    int blockSize = 11; // Side of the local window, odd, at most 255
+    int C = 2;          // Offset subtracted from the mean (Mean, Gaussian)
+    double k = 0.0;     // Weight of the standard deviation (Niblack, Sauvola)
+};
+
 class ImageProcessor
 {
 public:
@@ -11,13 +39,41 @@ public:
 
 public:
     static QImage applyTransformations(const QImage& src, int brightness, int contrast, bool isGray, bool isNegative);
+    // Fold the operations into lookup tables and apply them in a single pass over the image.
+    // Binarizing colour output takes a Grayscale8 conversion and a second pass on top.
+    static QImage applyPointOperations(const QImage& src, const PointOperations& ops);
     static std::vector<int> calculateHistogram(const QImage& src);
     static QImage binarizeManual(const QImage& src, int threshold);
     static QImage binarizeOtsu(const QImage& src);
-    static QImage binarizeAdaptive(const QImage& src);
+    static QImage binarizeAdaptive(const QImage& src, const AdaptiveThreshold& params = {});
+
+private:
+    // Channel and luminance sums of an image
+    struct ChannelSums {
+        size_t red = 0, green = 0, blue = 0, gray = 0;
+    };
+
+    // Sums of the image, computed once per image content (QImage::cacheKey)
+    static ChannelSums channelSums(const QImage& src);
+
+    // Summed-area tables of luminance and squared luminance, with a zero row and column in front.
+    // Entries wrap around modulo 2^32, box sums stay exact as long as they fit into 32 bits.
+    struct IntegralImage {
+        int width, height;
+        std::vector<uint8_t> luma;     // width * height
+        std::vector<uint32_t> sum;     // (width + 1) * (height + 1)
+        std::vector<uint32_t> squares; // (width + 1) * (height + 1)
+
+        // Sum over the pixels [x0; x1) x [y0; y1) of one of the tables
+        uint32_t boxSum(const std::vector<uint32_t>& table, int x0, int y0, int x1, int y1) const;
+    };
+
+    static IntegralImage buildIntegralImage(const QImage& src);
 
 private:
-    static void applyGrayscaleAndNegative(QImage& src, bool isGray, bool isNegative);
+    static std::mutex statsMutex;
+    static qint64 statsKey;         // Cache key of the image the sums below belong to
+    static ChannelSums statsCache;
 };
 
 #endif // IMAGEPROCESSOR_H
@@ -115,7 +115,8 @@ void MainWindow::setupUI() {
     QVBoxLayout *binLayout = new QVBoxLayout(binGroup);
 
     m_binariztionMethod = new QComboBox();
-    m_binariztionMethod->addItems({"Нет", "Фиксированный порог", "Метод Оцу", "Адаптивный порог"});
+    m_binariztionMethod->addItems({"Нет", "Фиксированный порог", "Метод Оцу", "Адаптивный порог",
+                                   "Адаптивный порог (Гаусс)", "Метод Ниблэка", "Метод Саувола"});
     connect(m_binariztionMethod, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::applyTransformations);
 
     m_thresholdSlider = new QSlider(Qt::Horizontal);
@@ -128,10 +129,36 @@ void MainWindow::setupUI() {
         thresholdLabel->setText(QString("Порог: %1").arg(m_thresholdSlider->value()));
     });
 
+    // Adaptive methods
+    m_blockSizeSlider = new QSlider(Qt::Horizontal);
+    m_blockSizeSlider->setRange(3, 101);
+    m_blockSizeSlider->setValue(11);
+    m_blockSizeSlider->setSingleStep(2);
+    QLabel *blockSizeLabel = new QLabel("Размер блока: 11");
+
+    connect(m_blockSizeSlider, &QSlider::valueChanged, this, [this, blockSizeLabel](){
+        m_updateTimer->start();
+        blockSizeLabel->setText(QString("Размер блока: %1").arg(m_blockSizeSlider->value() | 1));
+    });
+
+    m_offsetSlider = new QSlider(Qt::Horizontal);
+    m_offsetSlider->setRange(-20, 20);
+    m_offsetSlider->setValue(2);
+    QLabel *offsetLabel = new QLabel("C: 2");
+
+    connect(m_offsetSlider, &QSlider::valueChanged, this, [this, offsetLabel](){
+        m_updateTimer->start();
+        offsetLabel->setText(QString("C: %1").arg(m_offsetSlider->value()));
+    });
+
     binLayout->addWidget(new QLabel("Метод:"));
     binLayout->addWidget(m_binariztionMethod);
     binLayout->addWidget(thresholdLabel);
     binLayout->addWidget(m_thresholdSlider);
+    binLayout->addWidget(blockSizeLabel);
+    binLayout->addWidget(m_blockSizeSlider);
+    binLayout->addWidget(offsetLabel);
+    binLayout->addWidget(m_offsetSlider);
     rightLayout->addWidget(binGroup);
 
     rightLayout->addStretch(); // Push widgets to top
@@ -163,6 +190,7 @@ void MainWindow::loadImage() {
 
     m_originalImage = m_originalImage.convertToFormat(QImage::Format_ARGB32);
     m_processedImage = m_originalImage;
+    m_sourceRegion = QImage();
 
     m_scene->clear();
     m_imageItem = nullptr;
@@ -171,6 +199,8 @@ void MainWindow::loadImage() {
     m_brightnessSlider->setValue(0);
     m_contrastSlider->setValue(5000);
     m_thresholdSlider->setValue(128);
+    m_blockSizeSlider->setValue(11);
+    m_offsetSlider->setValue(2);
     m_grayscaleCheckBox->setCheckState(Qt::Unchecked);
     m_negativeCheckBox->setCheckState(Qt::Unchecked);
     m_binariztionMethod->setCurrentIndex(0);
@@ -223,33 +253,54 @@ void MainWindow::applyTransformations() {
         roi = base.rect();
     }
 
-    // Extract region to process
-    QImage region = base.copy(roi);
-
-    // Apply transforms
-    region = ImageProcessor::applyTransformations(
-        region,
-        m_brightnessSlider->value(),
-        m_contrastSlider->value(),
-        m_grayscaleCheckBox->isChecked(),
-        m_negativeCheckBox->isChecked()
-    );
+    // Extract region to process. The copy is kept while the selection stays the same,
+    // so statistics of the region cached by ImageProcessor survive slider drags.
+    if (m_sourceRegion.isNull() || m_sourceRegionRect != roi) {
+        m_sourceRegion = base.copy(roi);
+        m_sourceRegionRect = roi;
+    }
 
-    // Apply binarization
     int binarizationMode = m_binariztionMethod->currentIndex();
-    int threshold = m_thresholdSlider->value();
 
-    if (binarizationMode == 1)
-        region = ImageProcessor::binarizeManual(region, threshold);
-    else if (binarizationMode == 2)
+    // Apply transforms, a fixed threshold is folded into the same pass
+    PointOperations ops;
+    ops.grayscale = m_grayscaleCheckBox->isChecked();
+    ops.negative = m_negativeCheckBox->isChecked();
+    ops.brightness = m_brightnessSlider->value();
+    ops.contrast = m_contrastSlider->value();
+    if (binarizationMode == 1) ops.threshold = m_thresholdSlider->value();
+
+    QImage region = ImageProcessor::applyPointOperations(m_sourceRegion, ops);
+
+    // Apply binarization
+    if (binarizationMode == 2)
         region = ImageProcessor::binarizeOtsu(region);
-    else if (binarizationMode == 3)
-        region = ImageProcessor::binarizeAdaptive(region);
+    else if (binarizationMode >= 3) {
+        AdaptiveThreshold params;
+        params.blockSize = m_blockSizeSlider->value();
+        params.C = m_offsetSlider->value();
+
+        if (binarizationMode == 4) {
+            params.method = AdaptiveMethod::Gaussian;
+        } else if (binarizationMode == 5) {
+            params.method = AdaptiveMethod::Niblack;
+            params.k = -0.2;
+        } else if (binarizationMode == 6) {
+            params.method = AdaptiveMethod::Sauvola;
+            params.k = 0.5;
+        }
+
+        region = ImageProcessor::binarizeAdaptive(region, params);
+    }
 
     // Composite result
-    QPainter painter(&result);
-    painter.drawImage(roi.topLeft(), region);
-    painter.end();
+    if (roi == base.rect()) {
+        result = region;
+    } else {
+        QPainter painter(&result);
+        painter.drawImage(roi.topLeft(), region);
+        painter.end();
+    }
 
     m_processedImage = result;
     updateImage();
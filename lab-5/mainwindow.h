@@ -65,6 +65,8 @@ private:
     QGraphicsPixmapItem *m_imageItem;
     QImage m_originalImage;
     QImage m_processedImage;
+    QImage m_sourceRegion;   // Copy of the selected part of the original image
+    QRect m_sourceRegionRect;
 
     QTimer *m_updateTimer;
     QSlider *m_brightnessSlider;
@@ -75,6 +77,8 @@ private:
     QCheckBox *m_negativeCheckBox;
     QComboBox *m_binariztionMethod;
     QSlider *m_thresholdSlider;
+    QSlider *m_blockSizeSlider; // Window of the adaptive methods
+    QSlider *m_offsetSlider;    // C of the adaptive methods
 
     QGraphicsRectItem *m_selectionItem = nullptr;
     QPointF m_startPoint;
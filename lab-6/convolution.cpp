@@ -0,0 +1,393 @@
+#include "convolution.h"
+#include "rowbands.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr int CHANNELS = 3;
+
+// Weight applied to one pixel, or to the sum of two pixels that share it.
+// Offsets index the rows of the window and the (padded) values of a row.
+template <typename T>
+struct Term {
+    T weight;
+    int row0, x0;
+    int row1, x1; // row1 < 0 for a single pixel
+};
+
+// Terms of the non-zero weights of a rows x columns kernel, pairing each tap
+// with the opposite one when their weights are equal
+template <typename T>
+std::vector<Term<T>> makeTerms(const std::vector<T>& weights, int rows, int columns) {
+    std::vector<Term<T>> terms;
+    int count = rows * columns;
+
+    for (int t = 0; t <= (count - 1) / 2; ++t) {
+        int opposite = count - 1 - t;
+
+        if (opposite != t && weights[t] == weights[opposite]) {
+            if (weights[t] != T(0)) {
+                terms.push_back({ weights[t], t / columns, t % columns, opposite / columns, opposite % columns });
+            }
+            continue;
+        }
+
+        if (weights[t] != T(0)) {
+            terms.push_back({ weights[t], t / columns, t % columns, -1, 0 });
+        }
+        if (opposite != t && weights[opposite] != T(0)) {
+            terms.push_back({ weights[opposite], opposite / columns, opposite % columns, -1, 0 });
+        }
+    }
+
+    return terms;
+}
+
+// acc[x] += sum of the terms at x, for one channel; rows[i] is row i of the window
+template <typename T>
+void accumulateTerms(const std::vector<Term<T>>& terms, const T* const* rows, int width, T* acc) {
+    for (const Term<T>& term : terms) {
+        const T* a = rows[term.row0] + term.x0;
+
+        if (term.row1 < 0) {
+            for (int x = 0; x < width; ++x) {
+                acc[x] += term.weight * a[x];
+            }
+        } else {
+            const T* b = rows[term.row1] + term.x1;
+            for (int x = 0; x < width; ++x) {
+                acc[x] += term.weight * (a[x] + b[x]);
+            }
+        }
+    }
+}
+
+// Dense SIZE x SIZE kernel with every tap unrolled; a symmetric one multiplies half as often
+template <int SIZE, bool SYMMETRIC, typename T>
+void convolveFixed(const T* weights, const T* const* rows, int width, T* acc) {
+    constexpr int TAPS = SIZE * SIZE;
+    constexpr int CENTER = TAPS / 2;
+
+    for (int x = 0; x < width; ++x) {
+        T sum = 0;
+
+        if constexpr (SYMMETRIC) {
+            for (int t = 0; t < CENTER; ++t) {
+                sum += weights[t] * (rows[t / SIZE][x + t % SIZE] + rows[SIZE - 1 - t / SIZE][x + SIZE - 1 - t % SIZE]);
+            }
+            sum += weights[CENTER] * rows[SIZE / 2][x + SIZE / 2];
+        } else {
+            for (int t = 0; t < TAPS; ++t) {
+                sum += weights[t] * rows[t / SIZE][x + t % SIZE];
+            }
+        }
+
+        acc[x] = sum;
+    }
+}
+
+// Split a row into its color channels, with `padding` copies of the edge pixels on both sides
+template <typename T>
+void unpackRow(const QRgb* row, int width, int padding, T* const channels[CHANNELS]) {
+    for (int x = -padding; x < width + padding; ++x) {
+        QRgb pixel = row[std::clamp(x, 0, width - 1)];
+        channels[0][x + padding] = T(qRed(pixel));
+        channels[1][x + padding] = T(qGreen(pixel));
+        channels[2][x + padding] = T(qBlue(pixel));
+    }
+}
+
+// Channel sums of integer weights scaled by D back into [0; 255], dividing through a reciprocal.
+// Sums are clamped below 256 * D first, which keeps the product exact for D <= 65535.
+struct IntegerChannel {
+    int64_t limit;
+    uint64_t reciprocal;
+    int bits;
+
+    uchar operator()(int32_t sum) const {
+        if (sum <= 0) return 0;
+        return uchar((uint64_t(std::min<int64_t>(sum, limit)) * reciprocal) >> bits);
+    }
+};
+
+struct FloatChannel {
+    uchar operator()(double sum) const {
+        return uchar(std::clamp(static_cast<int>(std::clamp(sum, -1.0, 256.0)), 0, 255));
+    }
+};
+
+// Rows of the window around the current one, kept per channel. A row is stored in slot
+// (virtual row mod slot count), virtual rows above and below the image repeat its edge rows.
+template <typename T>
+class RowRing
+{
+public:
+    RowRing(int slotCount, int length)
+        : m_slotCount(slotCount)
+        , m_length(length)
+        , m_data(size_t(slotCount) * CHANNELS * length)
+    {
+    }
+
+    T* channel(int row, int c) {
+        int slot = ((row % m_slotCount) + m_slotCount) % m_slotCount;
+        return m_data.data() + (size_t(slot) * CHANNELS + c) * m_length;
+    }
+
+private:
+    int m_slotCount;
+    int m_length;
+    std::vector<T> m_data;
+};
+
+// Run the 2D convolution over rows [yBegin; yEnd) of source. fill(row, channels) stores
+// virtual row `row` into the ring, combine(window, c, acc) sums the window for channel c.
+template <typename T, typename Fill, typename Combine, typename Channel>
+void convolveBand(const QImage& source, int yBegin, int yEnd, int radiusY, int length,
+                  Fill&& fill, Combine&& combine, Channel&& finish, uchar* resultBits, qsizetype resultStride) {
+    int width = source.width();
+    int windowHeight = 2 * radiusY + 1;
+
+    RowRing<T> ring(windowHeight, length);
+    std::vector<T> acc(size_t(width) * CHANNELS);
+    std::vector<const T*> window(windowHeight);
+
+    auto load = [&](int row) {
+        T* channels[CHANNELS] = { ring.channel(row, 0), ring.channel(row, 1), ring.channel(row, 2) };
+        fill(row, channels);
+    };
+
+    for (int row = yBegin - radiusY; row < yBegin + radiusY; ++row) {
+        load(row);
+    }
+
+    for (int y = yBegin; y < yEnd; ++y) {
+        load(y + radiusY);
+
+        for (int c = 0; c < CHANNELS; ++c) {
+            for (int i = 0; i < windowHeight; ++i) {
+                window[i] = ring.channel(y - radiusY + i, c);
+            }
+            combine(window.data(), c, acc.data() + size_t(c) * width);
+        }
+
+        const T* red = acc.data();
+        const T* green = red + width;
+        const T* blue = green + width;
+        QRgb* out = reinterpret_cast<QRgb*>(resultBits + y * resultStride);
+
+        for (int x = 0; x < width; ++x) {
+            out[x] = qRgb(finish(red[x]), finish(green[x]), finish(blue[x]));
+        }
+    }
+}
+
+// Whole kernel applied to padded source rows
+template <typename T, typename Channel>
+void convolve2D(const QImage& source, const std::vector<T>& weights, int kernelWidth, int kernelHeight,
+                bool symmetric, Channel&& finish, QImage& result) {
+    int width = source.width();
+    int height = source.height();
+    int radiusX = kernelWidth / 2;
+    int radiusY = kernelHeight / 2;
+    int length = width + 2 * radiusX;
+
+    bool dense = std::none_of(weights.begin(), weights.end(), [](T weight) { return weight == T(0); });
+    int fixedSize = dense && kernelWidth == kernelHeight && (kernelWidth == 3 || kernelWidth == 5) ? kernelWidth : 0;
+    std::vector<Term<T>> terms = makeTerms(weights, kernelHeight, kernelWidth);
+
+    auto fill = [&](int row, T* const* channels) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(source.constScanLine(std::clamp(row, 0, height - 1)));
+        unpackRow(line, width, radiusX, channels);
+    };
+
+    auto combine = [&](const T* const* window, int, T* acc) {
+        if (fixedSize == 3) {
+            if (symmetric) convolveFixed<3, true>(weights.data(), window, width, acc);
+            else convolveFixed<3, false>(weights.data(), window, width, acc);
+        } else if (fixedSize == 5) {
+            if (symmetric) convolveFixed<5, true>(weights.data(), window, width, acc);
+            else convolveFixed<5, false>(weights.data(), window, width, acc);
+        } else {
+            std::fill(acc, acc + width, T(0));
+            accumulateTerms(terms, window, width, acc);
+        }
+    };
+
+    uchar* resultBits = result.bits();
+    qsizetype resultStride = result.bytesPerLine();
+
+    RowBands::run(height, source.bytesPerLine(), radiusY, [&](int yBegin, int yEnd) {
+        convolveBand<T>(source, yBegin, yEnd, radiusY, length, fill, combine, finish, resultBits, resultStride);
+    });
+}
+
+// Row factor applied to padded source rows as they enter the window, column factor down the window
+template <typename T, typename Channel>
+void convolveSeparable(const QImage& source, const std::vector<T>& row, const std::vector<T>& column,
+                       Channel&& finish, QImage& result) {
+    int width = source.width();
+    int height = source.height();
+    int radiusX = int(row.size()) / 2;
+    int radiusY = int(column.size()) / 2;
+
+    std::vector<Term<T>> rowTerms = makeTerms(row, 1, int(row.size()));
+    std::vector<Term<T>> columnTerms = makeTerms(column, int(column.size()), 1);
+
+    uchar* resultBits = result.bits();
+    qsizetype resultStride = result.bytesPerLine();
+
+    RowBands::run(height, source.bytesPerLine(), radiusY, [&](int yBegin, int yEnd) {
+        std::vector<T> padded(size_t(width + 2 * radiusX) * CHANNELS);
+
+        auto fill = [&](int y, T* const* channels) {
+            const QRgb* line = reinterpret_cast<const QRgb*>(source.constScanLine(std::clamp(y, 0, height - 1)));
+            T* unpacked[CHANNELS];
+            for (int c = 0; c < CHANNELS; ++c) {
+                unpacked[c] = padded.data() + size_t(c) * (width + 2 * radiusX);
+            }
+            unpackRow(line, width, radiusX, unpacked);
+
+            for (int c = 0; c < CHANNELS; ++c) {
+                const T* rows[] = { unpacked[c] };
+                std::fill(channels[c], channels[c] + width, T(0));
+                accumulateTerms(rowTerms, rows, width, channels[c]);
+            }
+        };
+
+        auto combine = [&](const T* const* window, int, T* acc) {
+            // Terms of a column index rows of the window; with one column their x offset is 0
+            std::fill(acc, acc + width, T(0));
+            accumulateTerms(columnTerms, window, width, acc);
+        };
+
+        convolveBand<T>(source, yBegin, yEnd, radiusY, width, fill, combine, finish, resultBits, resultStride);
+    });
+}
+
+double sumOfMagnitudes(const std::vector<double>& values) {
+    double sum = 0.0;
+    for (double value : values) sum += std::abs(value);
+    return sum;
+}
+} // namespace
+
+Convolution::Convolution(const Kernel& kernel) {
+    if (kernel.empty() || kernel[0].empty()) return;
+
+    // Even sizes grow by a zero row or column at the end
+    m_height = int(kernel.size()) | 1;
+    m_width = int(kernel[0].size()) | 1;
+    m_weights.assign(size_t(m_width) * m_height, 0.0);
+
+    for (int i = 0; i < int(kernel.size()); ++i) {
+        for (int j = 0; j < int(kernel[i].size()) && j < m_width; ++j) {
+            m_weights[size_t(i) * m_width + j] = kernel[i][j];
+        }
+    }
+
+    int count = int(m_weights.size());
+    m_symmetric = true;
+    for (int t = 0; t < count / 2; ++t) {
+        m_symmetric = m_symmetric && m_weights[t] == m_weights[count - 1 - t];
+    }
+
+    factorize();
+
+    // Sums of integer weights times 255 must fit into int32
+    constexpr double INT_RANGE = 2147483647.0 / 255.0;
+
+    if (m_separable) {
+        int64_t rowDenominator = commonDenominator(m_row);
+        int64_t columnDenominator = commonDenominator(m_column);
+        int64_t denominator = rowDenominator * columnDenominator;
+
+        if (denominator > 0 && denominator <= MAX_PRODUCT
+            && sumOfMagnitudes(m_row) * rowDenominator * sumOfMagnitudes(m_column) * columnDenominator < INT_RANGE) {
+            m_denominator = denominator;
+            m_integerRow = scaled(m_row, rowDenominator);
+            m_integerColumn = scaled(m_column, columnDenominator);
+        }
+    } else {
+        int64_t denominator = commonDenominator(m_weights);
+
+        if (denominator > 0 && denominator <= MAX_PRODUCT && sumOfMagnitudes(m_weights) * denominator < INT_RANGE) {
+            m_denominator = denominator;
+            m_integerWeights = scaled(m_weights, denominator);
+        }
+    }
+}
+
+void Convolution::factorize() {
+    // A single row or column gains nothing from two passes
+    if (m_width == 1 || m_height == 1) return;
+
+    auto pivot = std::max_element(m_weights.begin(), m_weights.end(),
+                                  [](double a, double b) { return std::abs(a) < std::abs(b); });
+    double largest = std::abs(*pivot);
+    if (largest == 0.0) return;
+
+    int pivotRow = int(pivot - m_weights.begin()) / m_width;
+    int pivotColumn = int(pivot - m_weights.begin()) % m_width;
+
+    std::vector<double> row(m_weights.begin() + size_t(pivotRow) * m_width,
+                            m_weights.begin() + size_t(pivotRow + 1) * m_width);
+    std::vector<double> column(m_height);
+    for (int i = 0; i < m_height; ++i) {
+        column[i] = m_weights[size_t(i) * m_width + pivotColumn] / *pivot;
+    }
+
+    for (int i = 0; i < m_height; ++i) {
+        for (int j = 0; j < m_width; ++j) {
+            if (std::abs(m_weights[size_t(i) * m_width + j] - column[i] * row[j]) > 1e-9 * largest) return;
+        }
+    }
+
+    m_separable = true;
+    m_row = std::move(row);
+    m_column = std::move(column);
+}
+
+int64_t Convolution::commonDenominator(const std::vector<double>& values) {
+    for (int64_t denominator = 1; denominator <= MAX_DENOMINATOR; ++denominator) {
+        bool integral = std::all_of(values.begin(), values.end(), [&](double value) {
+            double product = value * denominator;
+            return std::abs(product - std::round(product)) <= 1e-9 * std::max(1.0, std::abs(product));
+        });
+
+        if (integral) return denominator;
+    }
+
+    return 0;
+}
+
+std::vector<int32_t> Convolution::scaled(const std::vector<double>& values, int64_t denominator) {
+    std::vector<int32_t> result(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        result[i] = int32_t(std::lround(values[i] * denominator));
+    }
+    return result;
+}
+
+QImage Convolution::apply(const QImage& src) const {
+    if (src.isNull() || m_weights.empty()) return src;
+
+    QImage source = src.convertToFormat(QImage::Format_ARGB32);
+    QImage result(source.width(), source.height(), QImage::Format_ARGB32);
+
+    if (isInteger()) {
+        IntegerChannel finish = { 256 * m_denominator - 1,
+                                  ((uint64_t(1) << RECIPROCAL_BITS) + m_denominator - 1) / m_denominator,
+                                  RECIPROCAL_BITS };
+
+        if (m_separable) convolveSeparable(source, m_integerRow, m_integerColumn, finish, result);
+        else convolve2D(source, m_integerWeights, m_width, m_height, m_symmetric, finish, result);
+    } else {
+        if (m_separable) convolveSeparable(source, m_row, m_column, FloatChannel(), result);
+        else convolve2D(source, m_weights, m_width, m_height, m_symmetric, FloatChannel(), result);
+    }
+
+    return result;
+}
@@ -0,0 +1,60 @@
+#ifndef CONVOLUTION_H
+#define CONVOLUTION_H
+
+#include <QImage>
+
+#include <cstdint>
+#include <vector>
+
+using Kernel = std::vector<std::vector<double>>;
+
+// 2D convolution of the color channels with a kernel that is examined once, at construction,
+// to pick the cheapest way of applying it:
+//  - integer: all weights are multiples of 1 / D for a small D, so sums are exact in int32
+//  - separable: the kernel is a column times a row and runs as a horizontal and a vertical pass
+//  - symmetric: taps opposite each other share a weight, so their pixels are added before multiplying
+//  - zero taps are skipped, dense 3x3 and 5x5 kernels run through fully unrolled loops
+// Rows are unpacked into per-channel buffers whose borders replicate the edge pixels, so pixels
+// are never clamped one tap at a time. The result matches the former per-tap loop: channels are
+// truncated and clamped to [0; 255], alpha is opaque.
+class Convolution
+{
+public:
+    // Kernels of even width or height get a zero column or row appended, their center stays at size / 2
+    explicit Convolution(const Kernel& kernel);
+
+    QImage apply(const QImage& src) const;
+
+    bool isInteger() const { return m_denominator > 0; }
+    bool isSeparable() const { return m_separable; }
+    bool isSymmetric() const { return m_symmetric; }
+
+private:
+    static constexpr int MAX_DENOMINATOR = 1024;      // Largest D tried when looking for integer weights
+    static constexpr int64_t MAX_PRODUCT = 65535;     // Largest D of a whole kernel, keeps the division exact
+    static constexpr int RECIPROCAL_BITS = 40;        // Fixed-point precision of 1 / D
+
+    // Smallest D <= MAX_DENOMINATOR that turns all values into integers, 0 if there is none
+    static int64_t commonDenominator(const std::vector<double>& values);
+    static std::vector<int32_t> scaled(const std::vector<double>& values, int64_t denominator);
+
+    // Factor the kernel into m_column and m_row if it has rank one
+    void factorize();
+
+    int m_width = 0;  // Odd
+    int m_height = 0; // Odd
+    std::vector<double> m_weights; // Row-major
+
+    bool m_symmetric = false; // weight(i, j) == weight(height - 1 - i, width - 1 - j)
+    bool m_separable = false;
+    std::vector<double> m_row;    // weight(i, j) == m_column[i] * m_row[j]
+    std::vector<double> m_column;
+
+    // Weights multiplied by m_denominator, either of the whole kernel or of its two factors
+    int64_t m_denominator = 0;
+    std::vector<int32_t> m_integerWeights;
+    std::vector<int32_t> m_integerRow;
+    std::vector<int32_t> m_integerColumn;
+};
+
+#endif // CONVOLUTION_H
@@ -0,0 +1,68 @@
+#ifndef COUNTERRNG_H
+#define COUNTERRNG_H
+
+#include <cmath>
+#include <cstdint>
+
+// Counter-based random numbers: every value is a hash of (seed, x, y, stream) rather than the next
+// state of a generator. Any pixel (or dot, or line) gets the same numbers whatever order it's
+// processed in and whichever thread does it, so filters can split the image into bands freely and
+// still produce identical output for a given seed. Hashing is two rounds of the SplitMix64 finalizer.
+class CounterRng
+{
+public:
+    explicit CounterRng(uint64_t seed) : m_key(mix(seed)) {}
+
+    // 64 random bits for the given counter. Streams separate independent quantities
+    // drawn for the same coordinates (e.g. the x and y offsets of one pixel).
+    uint64_t bits(uint32_t x, uint32_t y, uint32_t stream = 0) const {
+        uint64_t counter = (uint64_t(y) << 32 | x) ^ (uint64_t(stream) * 0x9e3779b97f4a7c15ull);
+        return mix(m_key + mix(counter));
+    }
+
+    // Uniform integer in [lo; hi]
+    int uniformInt(int lo, int hi, uint32_t x, uint32_t y, uint32_t stream = 0) const {
+        return toRange(uint32_t(bits(x, y, stream) >> 32), lo, hi);
+    }
+
+    // Map 32 random bits onto [lo; hi], e.g. to get two integers out of one bits() call
+    static int toRange(uint32_t value, int lo, int hi) {
+        uint64_t range = uint64_t(int64_t(hi) - lo + 1);
+        return lo + int(value * range >> 32);
+    }
+
+    // Uniform float in [0; 1)
+    float uniform(uint32_t x, uint32_t y, uint32_t stream = 0) const {
+        return unit(uint32_t(bits(x, y, stream) >> 32));
+    }
+
+    // Two independent standard normal values (Box-Muller transform)
+    void normal(uint32_t x, uint32_t y, uint32_t stream, float& first, float& second) const {
+        uint64_t value = bits(x, y, stream);
+        float u1 = 1.0f - unit(uint32_t(value >> 32)); // (0; 1], so the logarithm is finite
+        float u2 = unit(uint32_t(value));
+
+        float r = std::sqrt(-2.0f * std::log(u1));
+        float angle = 2.0f * PI * u2;
+        first = r * std::cos(angle);
+        second = r * std::sin(angle);
+    }
+
+private:
+    static constexpr float PI = 3.14159265358979f;
+
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    // Top 24 bits, exactly representable in a float
+    static float unit(uint32_t value) {
+        return float(value >> 8) * (1.0f / 16777216.0f);
+    }
+
+    uint64_t m_key;
+};
+
+#endif // COUNTERRNG_H
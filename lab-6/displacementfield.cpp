@@ -0,0 +1,205 @@
+#include "displacementfield.h"
+#include "counterrng.h"
+#include "rowbands.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace {
+
+constexpr float TWO_PI = 6.28318530717959f;
+
+constexpr int WEIGHT_BITS = 8; // Fixed-point precision of the bilinear weights
+constexpr int WEIGHT_ONE = 1 << WEIGHT_BITS;
+constexpr uint32_t LOW_CHANNELS = 0x00ff00ff; // Blue and red, or (shifted down) green and alpha
+
+// Blend two pairs of 8-bit channels held in bits 0-7 and 16-23, weight out of WEIGHT_ONE
+inline uint32_t lerpPair(uint32_t a, uint32_t b, uint32_t weight) {
+    uint32_t sum = a * (WEIGHT_ONE - weight) + b * weight + 0x00800080;
+    return (sum >> WEIGHT_BITS) & LOW_CHANNELS;
+}
+
+inline QRgb lerpPixel(QRgb a, QRgb b, uint32_t weight) {
+    return lerpPair(a & LOW_CHANNELS, b & LOW_CHANNELS, weight)
+         | lerpPair((a >> 8) & LOW_CHANNELS, (b >> 8) & LOW_CHANNELS, weight) << 8;
+}
+
+} // namespace
+
+DisplacementField::DisplacementField(const QSize& size)
+    : m_size(size)
+    , m_offsets(size_t(std::max(size.width(), 0)) * std::max(size.height(), 0), Offset{ 0.0f, 0.0f })
+{
+}
+
+DisplacementField DisplacementField::fromOffsets(const QSize& size, std::vector<Offset> offsets) {
+    DisplacementField field;
+    if (offsets.size() != size_t(std::max(size.width(), 0)) * std::max(size.height(), 0)) return field;
+
+    field.m_size = size;
+    field.m_offsets = std::move(offsets);
+    for (const Offset& offset : field.m_offsets) {
+        field.m_reach = std::max(field.m_reach, std::abs(offset.dy));
+    }
+
+    return field;
+}
+
+template <typename Fn>
+void DisplacementField::generate(Fn&& fn) {
+    int width = m_size.width();
+    std::atomic<float> reach(0.0f);
+
+    RowBands::run(m_size.height(), width * qsizetype(sizeof(Offset)), 0, [&](int yBegin, int yEnd) {
+        float bandReach = 0.0f;
+
+        for (int y = yBegin; y < yEnd; ++y) {
+            Offset* row = m_offsets.data() + size_t(y) * width;
+            for (int x = 0; x < width; ++x) {
+                row[x] = fn(x, y);
+                bandReach = std::max(bandReach, std::abs(row[x].dy));
+            }
+        }
+
+        float current = reach.load();
+        while (bandReach > current && !reach.compare_exchange_weak(current, bandReach)) {
+        }
+    });
+
+    m_reach = reach.load();
+}
+
+DisplacementField DisplacementField::glass(const QSize& size, int radius, uint64_t seed) {
+    DisplacementField field(size);
+    CounterRng rng(seed);
+
+    // Both offsets come from one draw, its high and low halves
+    field.generate([&](int x, int y) {
+        uint64_t value = rng.bits(x, y);
+        return Offset{ float(CounterRng::toRange(uint32_t(value >> 32), -radius, radius)),
+                       float(CounterRng::toRange(uint32_t(value), -radius, radius)) };
+    });
+
+    return field;
+}
+
+DisplacementField DisplacementField::swirl(const QSize& size, float angle) {
+    DisplacementField field(size);
+
+    float cx = size.width() / 2.0f;
+    float cy = size.height() / 2.0f;
+    float radius = std::max(std::min(size.width(), size.height()) / 2.0f, 1.0f);
+
+    field.generate([&](int x, int y) {
+        float px = x + 0.5f - cx;
+        float py = y + 0.5f - cy;
+        float distance = std::sqrt(px * px + py * py);
+        if (distance >= radius) return Offset{ 0.0f, 0.0f };
+
+        float falloff = 1.0f - distance / radius;
+        float theta = angle * falloff * falloff;
+        float c = std::cos(theta);
+        float s = std::sin(theta);
+
+        // Rotate the pixel around the center, the offset is where it moved
+        return Offset{ px * c - py * s - px, px * s + py * c - py };
+    });
+
+    return field;
+}
+
+DisplacementField DisplacementField::ripple(const QSize& size, float amplitude, float wavelength) {
+    DisplacementField field(size);
+
+    float cx = size.width() / 2.0f;
+    float cy = size.height() / 2.0f;
+    float frequency = TWO_PI / std::max(wavelength, 1.0f);
+
+    field.generate([&](int x, int y) {
+        float px = x + 0.5f - cx;
+        float py = y + 0.5f - cy;
+        float distance = std::sqrt(px * px + py * py);
+        if (distance < 1e-3f) return Offset{ 0.0f, 0.0f };
+
+        // Along the radius, towards or away from the center
+        float shift = amplitude * std::sin(distance * frequency) / distance;
+        return Offset{ px * shift, py * shift };
+    });
+
+    return field;
+}
+
+DisplacementField DisplacementField::wave(const QSize& size, float amplitude, float wavelength) {
+    DisplacementField field(size);
+
+    float frequency = TWO_PI / std::max(wavelength, 1.0f);
+
+    field.generate([&](int x, int y) {
+        return Offset{ amplitude * std::sin(y * frequency), amplitude * std::sin(x * frequency) };
+    });
+
+    return field;
+}
+
+QImage DisplacementField::apply(const QImage& src) const {
+    if (src.isNull() || src.size() != m_size) return QImage();
+
+    QImage source = src.convertToFormat(QImage::Format_ARGB32);
+    int width = source.width();
+    int height = source.height();
+
+    const uchar* sourceBits = source.constBits();
+    qsizetype sourceStride = source.bytesPerLine();
+
+    QImage result(width, height, QImage::Format_ARGB32);
+    uchar* resultBits = result.bits();
+    qsizetype resultStride = result.bytesPerLine();
+
+    // Bands are sized for rows read at most this far from their own
+    int halo = static_cast<int>(std::ceil(m_reach)) + 1;
+
+    // Source coordinates are rounded to fixed point, WEIGHT_BITS below the pixel index
+    float maxX = float((width - 1) * WEIGHT_ONE);
+    float maxY = float((height - 1) * WEIGHT_ONE);
+
+    // Within a band the output is walked in columns of TILE_WIDTH, so for moderate offsets the
+    // source pixels read for one tile row are still cached when the next row needs their neighbours
+    RowBands::run(height, sourceStride, halo, [&](int yBegin, int yEnd) {
+        for (int tileBegin = 0; tileBegin < width; tileBegin += TILE_WIDTH) {
+            int tileEnd = std::min(tileBegin + TILE_WIDTH, width);
+
+            for (int y = yBegin; y < yEnd; ++y) {
+                const Offset* offsets = m_offsets.data() + size_t(y) * width;
+                QRgb* out = reinterpret_cast<QRgb*>(resultBits + y * resultStride);
+
+                for (int x = tileBegin; x < tileEnd; ++x) {
+                    int sx = static_cast<int>(std::clamp((x + offsets[x].dx) * WEIGHT_ONE, 0.0f, maxX) + 0.5f);
+                    int sy = static_cast<int>(std::clamp((y + offsets[x].dy) * WEIGHT_ONE, 0.0f, maxY) + 0.5f);
+
+                    int x0 = sx >> WEIGHT_BITS;
+                    int y0 = sy >> WEIGHT_BITS;
+                    uint32_t wx = sx & (WEIGHT_ONE - 1);
+                    uint32_t wy = sy & (WEIGHT_ONE - 1);
+
+                    const QRgb* top = reinterpret_cast<const QRgb*>(sourceBits + y0 * sourceStride);
+
+                    // Whole-pixel offsets (the glass effect, or no displacement) are plain copies
+                    if ((wx | wy) == 0) {
+                        out[x] = top[x0];
+                        continue;
+                    }
+
+                    // Neighbours past the last row or column have zero weight, so they repeat the edge
+                    int x1 = std::min(x0 + 1, width - 1);
+                    int y1 = std::min(y0 + 1, height - 1);
+                    const QRgb* bottom = reinterpret_cast<const QRgb*>(sourceBits + y1 * sourceStride);
+
+                    out[x] = lerpPixel(lerpPixel(top[x0], top[x1], wx), lerpPixel(bottom[x0], bottom[x1], wx), wy);
+                }
+            }
+        }
+    });
+
+    return result;
+}
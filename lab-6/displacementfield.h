@@ -0,0 +1,57 @@
+#ifndef DISPLACEMENTFIELD_H
+#define DISPLACEMENTFIELD_H
+
+#include <QImage>
+#include <QSize>
+
+#include <cstdint>
+#include <vector>
+
+// Per-pixel offsets for geometric effects: output pixel (x, y) takes the color at (x + dx, y + dy)
+// of the source, sampled bilinearly and clamped to the image. A field is generated once and can be
+// applied to any number of images of its size; the generators below cover the lab's effects.
+class DisplacementField
+{
+public:
+    struct Offset {
+        float dx;
+        float dy;
+    };
+
+    DisplacementField() = default;
+    // Zero offsets
+    explicit DisplacementField(const QSize& size);
+    // Offsets computed elsewhere, row-major; a null field if their number doesn't match the size
+    static DisplacementField fromOffsets(const QSize& size, std::vector<Offset> offsets);
+
+    // Random whole-pixel offsets in [-radius; radius], keyed by seed and pixel (see CounterRng)
+    static DisplacementField glass(const QSize& size, int radius, uint64_t seed);
+    // Rotation around the center by angle * (1 - r / R)^2 radians, R is half of the shorter side
+    static DisplacementField swirl(const QSize& size, float angle);
+    // Radial sine waves spreading from the center
+    static DisplacementField ripple(const QSize& size, float amplitude, float wavelength);
+    // Horizontal offsets varying along y and vertical ones along x, both sine waves
+    static DisplacementField wave(const QSize& size, float amplitude, float wavelength);
+
+    bool isNull() const { return m_offsets.empty(); }
+    QSize size() const { return m_size; }
+
+    // Row-major, size().width() * size().height() entries
+    const std::vector<Offset>& offsets() const { return m_offsets; }
+
+    // Warp src (of size()) through the field
+    QImage apply(const QImage& src) const;
+
+private:
+    static constexpr int TILE_WIDTH = 64; // Columns of a band warped before moving right
+
+    // Fill the field in row bands, fn(x, y) returns the offset of a pixel
+    template <typename Fn>
+    void generate(Fn&& fn);
+
+    QSize m_size;
+    std::vector<Offset> m_offsets;
+    float m_reach = 0.0f; // Largest vertical offset, in pixels
+};
+
+#endif // DISPLACEMENTFIELD_H
@@ -1,22 +1,25 @@
 #include "imageprocessor.h"
+#include "counterrng.h"
+#include "displacementfield.h"
+#include "primitiverasterizer.h"
+#include "rowbands.h"
 
-#include <QPainter>
-
-std::random_device ImageProcessor::rd = {};
-std::mt19937 ImageProcessor::rng(rd());
+#include <array>
+#include <limits>
+#include <memory>
 
 ImageProcessor::ImageProcessor() = default;
 
-QImage ImageProcessor::applySpotNoise(const QImage& src, int dotCount) {
+QImage ImageProcessor::applySpotNoise(const QImage& src, int dotCount, uint64_t seed) {
     if (src.isNull()) return QImage();
 
     QImage result = src;
+    CounterRng rng(seed);
 
-    std::uniform_int_distribution<> distX(0, src.width() - 1);
-    std::uniform_int_distribution<> distY(0, src.height() - 1);
-
-    for (size_t i = 0; i < dotCount; ++i) {
-        auto [x, y] = std::pair{ distX(rng), distY(rng) };
+    // Dot i lands where the counter (i, stream) says, the order they are drawn in doesn't matter
+    for (int i = 0; i < dotCount; ++i) {
+        int x = rng.uniformInt(0, src.width() - 1, i, 0, NOISE_X);
+        int y = rng.uniformInt(0, src.height() - 1, i, 0, NOISE_Y);
         QRgb *row = reinterpret_cast<QRgb*>(result.scanLine(y));
         row[x] = qRgb(255, 255, 255);
     }
@@ -24,85 +27,272 @@ QImage ImageProcessor::applySpotNoise(const QImage& src, int dotCount) {
     return result;
 }
 
-QImage ImageProcessor::applyLineNoise(const QImage& src, int lineCount) {
+QImage ImageProcessor::applyLineNoise(const QImage& src, int lineCount, uint64_t seed) {
     if (src.isNull()) return QImage();
 
-    QImage result = src;
-
-    std::uniform_int_distribution<> distX(0, src.width() - 1);
-    std::uniform_int_distribution<> distY(0, src.height() - 1);
+    QImage result = src.convertToFormat(QImage::Format_ARGB32);
+    CounterRng rng(seed);
 
-    QPainter painter(&result);
-    painter.setRenderHint(QPainter::Antialiasing);
-    painter.setPen(QPen(Qt::white, 2));
+    PrimitiveRasterizer rasterizer(NOISE_PEN_WIDTH);
+    rasterizer.reserve(lineCount);
 
-    for (size_t i = 0; i < lineCount; ++i) {
-        QPoint p1 = QPoint(distX(rng), distY(rng));
-        QPoint p2 = QPoint(distX(rng), distY(rng));
-        painter.drawLine(p1, p2);
+    for (int i = 0; i < lineCount; ++i) {
+        QPoint p1 = QPoint(rng.uniformInt(0, src.width() - 1, i, 0, NOISE_X), rng.uniformInt(0, src.height() - 1, i, 0, NOISE_Y));
+        QPoint p2 = QPoint(rng.uniformInt(0, src.width() - 1, i, 1, NOISE_X), rng.uniformInt(0, src.height() - 1, i, 1, NOISE_Y));
+        rasterizer.addLine(p1, p2);
     }
 
-    painter.end();
+    rasterizer.draw(result);
 
     return result;
 }
 
-QImage ImageProcessor::applyCircleNoise(const QImage& src, int circleCount) {
+QImage ImageProcessor::applyCircleNoise(const QImage& src, int circleCount, uint64_t seed) {
     if (src.isNull()) return QImage();
 
-    QImage result = src;
-
-    std::uniform_int_distribution<> distX(0, src.width() - 1);
-    std::uniform_int_distribution<> distY(0, src.height() - 1);
-    std::uniform_int_distribution<> distR(3, 10);
+    QImage result = src.convertToFormat(QImage::Format_ARGB32);
+    CounterRng rng(seed);
 
-    QPainter painter(&result);
-    painter.setRenderHint(QPainter::Antialiasing);
-    painter.setPen(QPen(Qt::white, 2));
+    PrimitiveRasterizer rasterizer(NOISE_PEN_WIDTH);
+    rasterizer.reserve(circleCount);
 
-    for (size_t i = 0; i < circleCount; ++i) {
-        QPoint center = QPoint(distX(rng), distY(rng));
-        int radius = distR(rng);
-        painter.drawEllipse(center, radius, radius);
+    for (int i = 0; i < circleCount; ++i) {
+        QPoint center = QPoint(rng.uniformInt(0, src.width() - 1, i, 0, NOISE_X), rng.uniformInt(0, src.height() - 1, i, 0, NOISE_Y));
+        int radius = rng.uniformInt(3, 10, i, 0, NOISE_VALUE);
+        rasterizer.addCircle(center, radius);
     }
 
-    painter.end();
+    rasterizer.draw(result);
 
     return result;
 }
 
-QImage ImageProcessor::applyMedianFilter(const QImage& src, int kernelSize) {
+QImage ImageProcessor::applyGaussianNoise(const QImage& src, double sigma, uint64_t seed) {
+    if (src.isNull()) return QImage();
+
+    QImage source = src.convertToFormat(QImage::Format_ARGB32);
+    int width = source.width();
+    int height = source.height();
+    CounterRng rng(seed);
+    float deviation = static_cast<float>(sigma);
+
+    QImage result(width, height, QImage::Format_ARGB32);
+    uchar* resultBits = result.bits();
+    qsizetype resultStride = result.bytesPerLine();
+
+    RowBands::run(height, source.bytesPerLine(), 0, [&](int yBegin, int yEnd) {
+        auto noisy = [deviation](int value, float noise) {
+            return std::clamp(static_cast<int>(std::lround(value + deviation * noise)), 0, 255);
+        };
+
+        for (int y = yBegin; y < yEnd; ++y) {
+            const QRgb* in = reinterpret_cast<const QRgb*>(source.constScanLine(y));
+            QRgb* out = reinterpret_cast<QRgb*>(resultBits + y * resultStride);
+
+            for (int x = 0; x < width; ++x) {
+                // Independent noise in every channel, two normal values per draw
+                float red, green, blue, unused;
+                rng.normal(x, y, NOISE_VALUE, red, green);
+                rng.normal(x, y, NOISE_VALUE + 1, blue, unused);
+
+                QRgb pixel = in[x];
+                out[x] = qRgba(noisy(qRed(pixel), red), noisy(qGreen(pixel), green), noisy(qBlue(pixel), blue), qAlpha(pixel));
+            }
+        }
+    });
+
+    return result;
+}
+
+QImage ImageProcessor::applySaltAndPepperNoise(const QImage& src, double density, uint64_t seed) {
+    if (src.isNull()) return QImage();
+
+    QImage source = src.convertToFormat(QImage::Format_ARGB32);
+    int width = source.width();
+    int height = source.height();
+    CounterRng rng(seed);
+
+    // A pixel is hit if the top 32 bits of its draw are below this, the next bit picks salt or pepper
+    uint64_t threshold = static_cast<uint64_t>(std::clamp(density, 0.0, 1.0) * 4294967296.0);
+
+    QImage result(width, height, QImage::Format_ARGB32);
+    uchar* resultBits = result.bits();
+    qsizetype resultStride = result.bytesPerLine();
+
+    RowBands::run(height, source.bytesPerLine(), 0, [&](int yBegin, int yEnd) {
+        for (int y = yBegin; y < yEnd; ++y) {
+            const QRgb* in = reinterpret_cast<const QRgb*>(source.constScanLine(y));
+            QRgb* out = reinterpret_cast<QRgb*>(resultBits + y * resultStride);
+
+            for (int x = 0; x < width; ++x) {
+                uint64_t value = rng.bits(x, y, NOISE_VALUE);
+                if ((value >> 32) < threshold) {
+                    out[x] = value & 1 ? qRgb(255, 255, 255) : qRgb(0, 0, 0);
+                } else {
+                    out[x] = in[x];
+                }
+            }
+        }
+    });
+
+    return result;
+}
+
+QImage ImageProcessor::applyMedianFilter(const QImage& src, int kernelSize, MedianMode mode) {
     if (src.isNull()) return QImage();
 
     if (kernelSize % 2 == 0) kernelSize++;
 
-    QImage result = src;
-    int width = src.width();
-    int height = src.height();
+    if (mode == MedianMode::PerChannel) {
+        // 16-bit histogram bins hold windows up to 255x255
+        return applyPerChannelMedianFilter(src.convertToFormat(QImage::Format_ARGB32), std::min(kernelSize / 2, 127));
+    }
+
+    QImage image = src.convertToFormat(QImage::Format_ARGB32);
+    QImage result(image.width(), image.height(), QImage::Format_ARGB32);
+    int width = image.width();
+    int height = image.height();
     int radius = kernelSize / 2;
     auto cmp = [](const QRgb& lhs, const QRgb& rhs) {
         return qGray(lhs) < qGray(rhs);
     };
 
     std::vector<QRgb> window;
+    std::vector<const QRgb*> rows(kernelSize);
 
     for (int y = 0; y < height; ++y) {
+        // Rows covered by the window, clamped at the edges
+        for (int wy = -radius; wy <= radius; ++wy) {
+            int py = std::clamp(y + wy, 0, height - 1);
+            rows[wy + radius] = reinterpret_cast<const QRgb*>(image.constScanLine(py));
+        }
+
+        QRgb* out = reinterpret_cast<QRgb*>(result.scanLine(y));
+
         for (int x = 0; x < width; ++x) {
             window.clear();
 
-            for (int wy = -radius; wy <= radius; ++wy) {
+            for (const QRgb* row : rows) {
                 for (int wx = -radius; wx <= radius; ++wx) {
                     // Handle edges
                     int px = std::clamp(x + wx, 0, width - 1);
-                    int py = std::clamp(y + wy, 0, height - 1);
-
-                    QRgb pixel = src.pixel(px, py);
-                    window.emplace_back(pixel);
+                    window.emplace_back(row[px]);
                 }
             }
 
-            std::sort(window.begin(), window.end(), cmp);
-            result.setPixel(x, y, window[window.size() / 2]);
+            // Only the middle element has to be in place
+            auto middle = window.begin() + window.size() / 2;
+            std::nth_element(window.begin(), middle, window.end(), cmp);
+            out[x] = *middle;
+        }
+    }
+
+    return result;
+}
+
+QImage ImageProcessor::applyPerChannelMedianFilter(const QImage& src, int radius) {
+    // Perreault & Hebert, "Median Filtering in Constant Time": every column keeps a histogram
+    // of its 2r+1 pixels, the window histogram is the sum of 2r+1 column histograms. Moving
+    // right adds one column and removes another, moving down updates each column by one pixel.
+    // A coarse 16-bin level on top of the 256 fine bins keeps the median search short.
+    constexpr int CHANNELS = 3;
+    constexpr int BINS = 256;
+    constexpr int COARSE_BINS = 16;
+    constexpr int FINE_PER_COARSE = BINS / COARSE_BINS;
+    constexpr int COLUMN_FINE = CHANNELS * BINS;
+    constexpr int COLUMN_COARSE = CHANNELS * COARSE_BINS;
+
+    int w = src.width();
+    int h = src.height();
+    int rank = (2 * radius + 1) * (2 * radius + 1) / 2; // Position of the median in the sorted window
+
+    // Column histograms laid out as [x][channel][bin], so one column is a contiguous block
+    std::vector<uint16_t> columnFine(size_t(w) * COLUMN_FINE, 0);
+    std::vector<uint16_t> columnCoarse(size_t(w) * COLUMN_COARSE, 0);
+    std::array<uint16_t, COLUMN_FINE> kernelFine;
+    std::array<uint16_t, COLUMN_COARSE> kernelCoarse;
+
+    // Add (or remove) a whole image row to every column histogram
+    auto updateColumns = [&](int y, int delta) {
+        const QRgb* row = reinterpret_cast<const QRgb*>(src.constScanLine(std::clamp(y, 0, h - 1)));
+
+        for (int x = 0; x < w; ++x) {
+            uint16_t* fine = columnFine.data() + size_t(x) * COLUMN_FINE;
+            uint16_t* coarse = columnCoarse.data() + size_t(x) * COLUMN_COARSE;
+            int values[CHANNELS] = { qRed(row[x]), qGreen(row[x]), qBlue(row[x]) };
+
+            for (int c = 0; c < CHANNELS; ++c) {
+                fine[c * BINS + values[c]] += delta;
+                coarse[c * COARSE_BINS + values[c] / FINE_PER_COARSE] += delta;
+            }
+        }
+    };
+
+    auto fineColumn = [&](int x) { return columnFine.data() + size_t(std::clamp(x, 0, w - 1)) * COLUMN_FINE; };
+    auto coarseColumn = [&](int x) { return columnCoarse.data() + size_t(std::clamp(x, 0, w - 1)) * COLUMN_COARSE; };
+
+    // Move the window histogram one column to the right
+    auto slideKernel = [&](int removeX, int addX) {
+        const uint16_t* removeFine = fineColumn(removeX);
+        const uint16_t* addFine = fineColumn(addX);
+        const uint16_t* removeCoarse = coarseColumn(removeX);
+        const uint16_t* addCoarse = coarseColumn(addX);
+
+        for (int i = 0; i < COLUMN_FINE; ++i) {
+            kernelFine[i] += addFine[i] - removeFine[i];
+        }
+        for (int i = 0; i < COLUMN_COARSE; ++i) {
+            kernelCoarse[i] += addCoarse[i] - removeCoarse[i];
+        }
+    };
+
+    auto median = [&](int c) {
+        const uint16_t* coarse = kernelCoarse.data() + c * COARSE_BINS;
+        const uint16_t* fine = kernelFine.data() + c * BINS;
+
+        int count = 0;
+        int bin = 0;
+        while (count + coarse[bin] <= rank) {
+            count += coarse[bin++];
+        }
+
+        int value = bin * FINE_PER_COARSE;
+        while (count + fine[value] <= rank) {
+            count += fine[value++];
+        }
+
+        return value;
+    };
+
+    for (int y = -radius; y <= radius; ++y) {
+        updateColumns(y, 1);
+    }
+
+    QImage result(w, h, QImage::Format_ARGB32);
+
+    for (int y = 0; y < h; ++y) {
+        kernelFine.fill(0);
+        kernelCoarse.fill(0);
+        for (int x = -radius; x <= radius; ++x) {
+            const uint16_t* fine = fineColumn(x);
+            const uint16_t* coarse = coarseColumn(x);
+            for (int i = 0; i < COLUMN_FINE; ++i) kernelFine[i] += fine[i];
+            for (int i = 0; i < COLUMN_COARSE; ++i) kernelCoarse[i] += coarse[i];
+        }
+
+        QRgb* out = reinterpret_cast<QRgb*>(result.scanLine(y));
+
+        for (int x = 0; x < w; ++x) {
+            out[x] = qRgb(median(0), median(1), median(2));
+
+            if (x + 1 < w) {
+                slideKernel(x - radius, x + radius + 1);
+            }
+        }
+
+        if (y + 1 < h) {
+            updateColumns(y - radius, -1);
+            updateColumns(y + radius + 1, 1);
         }
     }
 
@@ -114,70 +304,151 @@ QImage ImageProcessor::applyGaussianFilter(const QImage& src, int kernelSize) {
 
     if (kernelSize % 2 == 0) kernelSize++;
 
-    int width = src.width();
-    int height = src.height();
-    int radius = kernelSize / 2;
+    QImage image = src.convertToFormat(QImage::Format_ARGB32);
+    QImage transposed(image.height(), image.width(), QImage::Format_ARGB32);
+    QImage result(image.width(), image.height(), QImage::Format_ARGB32);
 
-    QImage result = src.copy();
+    double sigma = (kernelSize - 1) / 6.0;
 
-    Kernel kernel(kernelSize, std::vector<double>(kernelSize));
-    double sum = 0.0;
+    // Large kernels are approximated by a cascade of box filters,
+    // which costs the same per pixel whatever the kernel size is
+    if (kernelSize >= GAUSSIAN_BOX_CASCADE_SIZE) {
+        for (int radius : boxCascadeRadii(sigma, 3)) {
+            boxFilterRowsTransposed(image, transposed, radius);
+            boxFilterRowsTransposed(transposed, result, radius);
+            std::swap(image, result);
+        }
 
-    double sigma = (kernelSize - 1) / 6.0;
-    double twoSigmaSq = 2.0 * sigma * sigma;
+        return image;
+    }
 
-    // Calculate h_{l,k}
-    for (int l = -radius; l <= radius; ++l) {
-        for (int k = -radius; k <= radius; ++k) {
-            double exponent = static_cast<double>(-(l*l + k*k)) / twoSigmaSq;
-            double value = std::exp(exponent);
+    int radius = kernelSize / 2;
+    std::vector<int32_t> weights(kernelSize);
+    std::vector<double> kernel(kernelSize);
+    double sum = 0.0;
 
-            kernel[l + radius][k + radius] = value;
-            sum += value;
-        }
+    // 2D Gaussian is a product of two 1D ones, so a single row of h_{l,k} is enough
+    double twoSigmaSq = 2.0 * sigma * sigma;
+    for (int k = -radius; k <= radius; ++k) {
+        kernel[k + radius] = std::exp(-static_cast<double>(k * k) / twoSigmaSq);
+        sum += kernel[k + radius];
     }
 
-    // Normalize (calculate A * h_{l, k})
+    // Normalize into fixed-point, the rounding error goes into the center tap so weights sum up exactly to one
+    int32_t fixedSum = 0;
     for (int i = 0; i < kernelSize; ++i) {
-        for (int j = 0; j < kernelSize; ++j) {
-            kernel[i][j] /= sum;
-        }
+        weights[i] = static_cast<int32_t>(std::lround(kernel[i] / sum * (1 << WEIGHT_BITS)));
+        fixedSum += weights[i];
     }
+    weights[radius] += (1 << WEIGHT_BITS) - fixedSum;
 
-    // Apply
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
+    // Horizontal pass writes columns, so the vertical pass reads rows as well
+    convolveRowsTransposed(image, transposed, weights);
+    convolveRowsTransposed(transposed, result, weights);
 
-            double r = 0.0;
-            double g = 0.0;
-            double b = 0.0;
+    return result;
+}
 
-            for (int wy = -radius; wy <= radius; ++wy) {
-                for (int wx = -radius; wx <= radius; ++wx) {
-                    // Handle edges
-                    int px = std::clamp(x + wx, 0, width - 1);
-                    int py = std::clamp(y + wy, 0, height - 1);
+void ImageProcessor::convolveRowsTransposed(const QImage& src, QImage& dst, const std::vector<int32_t>& weights) {
+    int w = src.width();
+    int h = src.height();
+    int taps = static_cast<int>(weights.size());
+    int radius = taps / 2;
 
-                    QRgb pixel = src.pixel(px, py);
+    uchar* dstBits = dst.bits();
+    qsizetype dstStride = dst.bytesPerLine();
 
-                    double weight = kernel[wy + radius][wx + radius];
+    // Row with replicated border pixels, so taps never need clamping
+    std::vector<QRgb> padded(w + 2 * radius);
 
-                    r += qRed(pixel)   * weight;
-                    g += qGreen(pixel) * weight;
-                    b += qBlue(pixel)  * weight;
-                }
+    for (int y = 0; y < h; ++y) {
+        const QRgb* row = reinterpret_cast<const QRgb*>(src.constScanLine(y));
+        std::fill(padded.begin(), padded.begin() + radius, row[0]);
+        std::copy(row, row + w, padded.begin() + radius);
+        std::fill(padded.begin() + radius + w, padded.end(), row[w - 1]);
+
+        for (int x = 0; x < w; ++x) {
+            const QRgb* window = padded.data() + x;
+            int32_t r = 1 << (WEIGHT_BITS - 1);
+            int32_t g = r;
+            int32_t b = r;
+
+            for (int i = 0; i < taps; ++i) {
+                QRgb pixel = window[i];
+                int32_t weight = weights[i];
+
+                r += qRed(pixel)   * weight;
+                g += qGreen(pixel) * weight;
+                b += qBlue(pixel)  * weight;
             }
 
-            // Write back
-            result.setPixel(x, y, qRgb(
-                std::clamp(static_cast<int>(r), 0, 255),
-                std::clamp(static_cast<int>(g), 0, 255),
-                std::clamp(static_cast<int>(b), 0, 255)
-            ));
+            // Weights are non-negative and sum up to one, so no clamping is needed
+            QRgb* column = reinterpret_cast<QRgb*>(dstBits + x * dstStride);
+            column[y] = qRgb(r >> WEIGHT_BITS, g >> WEIGHT_BITS, b >> WEIGHT_BITS);
         }
     }
+}
 
-    return result;
+void ImageProcessor::boxFilterRowsTransposed(const QImage& src, QImage& dst, int radius) {
+    int w = src.width();
+    int h = src.height();
+    int size = 2 * radius + 1;
+    uint32_t reciprocal = ((1u << WEIGHT_BITS) + size / 2) / size; // 1 / size in fixed-point
+
+    uchar* dstBits = dst.bits();
+    qsizetype dstStride = dst.bytesPerLine();
+
+    std::vector<QRgb> padded(w + 2 * radius);
+
+    for (int y = 0; y < h; ++y) {
+        const QRgb* row = reinterpret_cast<const QRgb*>(src.constScanLine(y));
+        std::fill(padded.begin(), padded.begin() + radius, row[0]);
+        std::copy(row, row + w, padded.begin() + radius);
+        std::fill(padded.begin() + radius + w, padded.end(), row[w - 1]);
+
+        // Running sums over the window, updated by one pixel in and one out per step
+        uint32_t r = 0, g = 0, b = 0;
+        for (int i = 0; i < size; ++i) {
+            r += qRed(padded[i]);
+            g += qGreen(padded[i]);
+            b += qBlue(padded[i]);
+        }
+
+        for (int x = 0; x < w; ++x) {
+            QRgb* column = reinterpret_cast<QRgb*>(dstBits + x * dstStride);
+            column[y] = qRgb(std::min(255u, (r * reciprocal + (1u << (WEIGHT_BITS - 1))) >> WEIGHT_BITS),
+                             std::min(255u, (g * reciprocal + (1u << (WEIGHT_BITS - 1))) >> WEIGHT_BITS),
+                             std::min(255u, (b * reciprocal + (1u << (WEIGHT_BITS - 1))) >> WEIGHT_BITS));
+
+            if (x + 1 < w) {
+                QRgb in = padded[x + size];
+                QRgb out = padded[x];
+                r += qRed(in)   - qRed(out);
+                g += qGreen(in) - qGreen(out);
+                b += qBlue(in)  - qBlue(out);
+            }
+        }
+    }
+}
+
+std::vector<int> ImageProcessor::boxCascadeRadii(double sigma, int passes) {
+    // Box widths whose successive application has the same variance as a Gaussian with a given sigma
+    double idealWidth = std::sqrt(12.0 * sigma * sigma / passes + 1.0);
+    int lower = static_cast<int>(std::floor(idealWidth));
+    if (lower % 2 == 0) lower--;
+    int upper = lower + 2;
+
+    double idealLowerCount = (12.0 * sigma * sigma - passes * lower * lower - 4.0 * passes * lower - 3.0 * passes)
+                             / (-4.0 * lower - 4.0);
+    int lowerCount = static_cast<int>(std::lround(idealLowerCount));
+
+    std::vector<int> radii;
+    for (int i = 0; i < passes; ++i) {
+        int width = (i < lowerCount) ? lower : upper;
+        radii.push_back(width / 2);
+    }
+
+    return radii;
 }
 
 QImage ImageProcessor::applyBasicSharpeningFilter(const QImage& src, int k) {
@@ -189,27 +460,15 @@ QImage ImageProcessor::applyBasicSharpeningFilter(const QImage& src, int k) {
 }
 
 QImage ImageProcessor::applySobelFilter(const QImage& src, int k) {
-    Kernel kernelY = { { 1, 2, 1 }, { 0, 0, 0 }, { -1, -2, -1 } };
-    Kernel kernelX = { { 1, 0, -1 }, { 2, 0, -2 }, { 1, 0, -1 } };
-
-    QImage edges = applyEdgeDetection(src, kernelX, kernelY);
-    return addWeighted(src, 1.0, edges, k / 20.0, 0.0);
+    return applyGradientFilter(src, GradientOperator::Sobel, k);
 }
 
 QImage ImageProcessor::applyPrewittFilter(const QImage& src, int k) {
-    Kernel kernelY = { { 1, 1, 1 }, { 0, 0, 0 }, { -1, -1, -1 } };
-    Kernel kernelX = { { 1, 0, -1 }, { 1, 0, -1 }, { 1, 0, -1 } };
-
-    QImage edges = applyEdgeDetection(src, kernelX, kernelY);
-    return addWeighted(src, 1.0, edges, k / 20.0, 0.0);
+    return applyGradientFilter(src, GradientOperator::Prewitt, k);
 }
 
 QImage ImageProcessor::applyRobertsFilter(const QImage& src, int k) {
-    Kernel kernelY = { { 0, 0, 0 }, { 0, -1, 0 }, { 0, 0, 1 } };
-    Kernel kernelX = { { 0, 0, 0 }, { 0, 0, -1 }, { 0, 1, 0 } };
-
-    QImage edges = applyEdgeDetection(src, kernelX, kernelY);
-    return addWeighted(src, 1.0, edges, k / 20.0, 0.0);
+    return applyGradientFilter(src, GradientOperator::Roberts, k);
 }
 
 QImage ImageProcessor::applyLaplacian(const QImage& src, int k) {
@@ -226,127 +485,407 @@ QImage ImageProcessor::applyLaplacian(const QImage& src, int k) {
     return applyKernel(src, combinedKernel);
 }
 
-QImage ImageProcessor::applyEdgeDetection(const QImage& src, const Kernel& kx, const Kernel& ky) {
-    int width = src.width();
-    int height = src.height();
-
-    int radius = 1; // 3x3 matrix
-
-    QImage result = src.copy();
+namespace {
 
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            double gx = 0;
-            double gy = 0;
+// Derivatives of a 3x3 operator at column x of three padded rows: middle is the weight of the
+// middle row (column), 2 for Sobel and 1 for Prewitt. gx grows to the right, gy downwards.
+template <typename T>
+inline void derivatives3x3(const T* top, const T* center, const T* bottom, int x, T middle, T& gx, T& gy) {
+    gx = top[x + 1] + middle * center[x + 1] + bottom[x + 1] - top[x - 1] - middle * center[x - 1] - bottom[x - 1];
+    gy = bottom[x - 1] + middle * bottom[x] + bottom[x + 1] - top[x - 1] - middle * top[x] - top[x + 1];
+}
 
-            for (int j = -radius; j <= radius; ++j) {
-                for (int i = -radius; i <= radius; ++i) {
-                    int nx = std::clamp(x + i, 0, width - 1);
-                    int ny = std::clamp(y + j, 0, height - 1);
+}
 
-                    int intensity = qGray(src.pixel(nx, ny));
+QImage ImageProcessor::applyGradientFilter(const QImage& src, GradientOperator op, int k, QImage* orientation) {
+    if (src.isNull()) return QImage();
 
-                    gx += intensity * kx[j + radius][i + radius];
-                    gy += intensity * ky[j + radius][i + radius];
-                }
-            }
+    QImage source = src.convertToFormat(QImage::Format_ARGB32);
+    int width = source.width();
+    int height = source.height();
 
-            // Calculate magnitude
-            double magnitude = std::sqrt(gx * gx + gy * gy);
-            int val = std::clamp(static_cast<int>(magnitude), 0, 255);
+    QImage result(width, height, QImage::Format_ARGB32);
+    uchar* resultBits = result.bits();
+    qsizetype resultStride = result.bytesPerLine();
 
-            result.setPixel(x, y, qRgb(val, val, val));
-        }
+    uchar* angleBits = nullptr;
+    qsizetype angleStride = 0;
+    if (orientation) {
+        *orientation = QImage(width, height, QImage::Format_Grayscale8);
+        angleBits = orientation->bits();
+        angleStride = orientation->bytesPerLine();
     }
 
-    return result;
-}
+    // What a magnitude adds to every channel, floor(magnitude * k / 20) in exact integers
+    std::array<int, 256> offsets;
+    for (int magnitude = 0; magnitude < 256; ++magnitude) {
+        int product = magnitude * k;
+        offsets[magnitude] = product >= 0 ? product / 20 : -((19 - product) / 20);
+    }
 
-QImage ImageProcessor::addWeighted(const QImage& src1, double alpha, const QImage& src2, double beta, double gamma) {
-    if (src1.size() != src2.size()) return src1;
+    // Weight of the middle row (column) in the 3x3 operators: 1 2 1 for Sobel, 1 1 1 for Prewitt
+    int middle = op == GradientOperator::Sobel ? 2 : 1;
 
-    QImage result = src1.copy();
-    int w = src1.width();
-    int h = src1.height();
+    RowBands::run(height, source.bytesPerLine(), 1, [&](int yBegin, int yEnd) {
+        // Luminance of rows y - 1, y and y + 1, each padded with a copy of its edge pixels
+        qsizetype lumaStride = width + 2;
+        std::vector<int32_t> lumaRows(lumaStride * 3);
 
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            QRgb p1 = src1.pixel(x, y);
-            QRgb p2 = src2.pixel(x, y);
+        auto luma = [&](int row) {
+            return lumaRows.data() + (row + 3) % 3 * lumaStride + 1;
+        };
 
-            int r = static_cast<int>(qRed(p1) * alpha + qRed(p2) * beta + gamma);
-            int g = static_cast<int>(qGreen(p1) * alpha + qGreen(p2) * beta + gamma);
-            int b = static_cast<int>(qBlue(p1) * alpha + qBlue(p2) * beta + gamma);
+        auto load = [&](int row) {
+            const QRgb* line = reinterpret_cast<const QRgb*>(source.constScanLine(std::clamp(row, 0, height - 1)));
+            int32_t* out = luma(row);
+            for (int x = 0; x < width; ++x) {
+                out[x] = qGray(line[x]);
+            }
+            out[-1] = out[0];
+            out[width] = out[width - 1];
+        };
+
+        load(yBegin - 1);
+        load(yBegin);
+
+        for (int y = yBegin; y < yEnd; ++y) {
+            load(y + 1);
+
+            const int32_t* top = luma(y - 1);
+            const int32_t* center = luma(y);
+            const int32_t* bottom = luma(y + 1);
+            const QRgb* in = reinterpret_cast<const QRgb*>(source.constScanLine(y));
+            QRgb* out = reinterpret_cast<QRgb*>(resultBits + y * resultStride);
+            uchar* angles = angleBits ? angleBits + y * angleStride : nullptr;
+
+            for (int x = 0; x < width; ++x) {
+                int gx, gy;
+                if (op == GradientOperator::Roberts) {
+                    gx = bottom[x] - center[x + 1];
+                    gy = bottom[x + 1] - center[x];
+                } else {
+                    derivatives3x3(top, center, bottom, x, middle, gx, gy);
+                }
 
-            result.setPixel(x, y, qRgb(std::clamp(r, 0, 255),
-                                       std::clamp(g, 0, 255),
-                                       std::clamp(b, 0, 255)));
+                // Magnitudes past 255 are clamped anyway, below it a float square root truncates exactly
+                int squared = gx * gx + gy * gy;
+                int magnitude = squared >= 255 * 255 ? 255 : static_cast<int>(std::sqrt(static_cast<float>(squared)));
+                int offset = offsets[magnitude];
+
+                QRgb pixel = in[x];
+                out[x] = qRgb(std::clamp(qRed(pixel) + offset, 0, 255),
+                              std::clamp(qGreen(pixel) + offset, 0, 255),
+                              std::clamp(qBlue(pixel) + offset, 0, 255));
+
+                if (angles) {
+                    // Direction from [-pi; pi] to [0; 255], wrapping around
+                    constexpr float PI = 3.14159265f;
+                    float angle = std::atan2(static_cast<float>(gy), static_cast<float>(gx));
+                    angles[x] = uchar(static_cast<int>(std::floor((angle + PI) * (128.0f / PI))) & 255);
+                }
+            }
         }
-    }
+    });
 
     return result;
 }
 
-QImage ImageProcessor::applyKernel(const QImage& src, const std::vector<std::vector<double>>& kernel) {
-    int kernelHeight = kernel.size();
-    int kernelWidth = kernel[0].size();
-    int radiusY = kernelHeight / 2;
-    int radiusX = kernelWidth / 2;
+QImage ImageProcessor::applyCannyFilter(const QImage& src, double sigma, int lowThreshold, int highThreshold) {
+    if (src.isNull()) return QImage();
 
-    int w = src.width();
-    int h = src.height();
-    QImage result = src.copy();
+    QImage source = src.convertToFormat(QImage::Format_ARGB32);
+    int width = source.width();
+    int height = source.height();
+    if (lowThreshold > highThreshold) std::swap(lowThreshold, highThreshold);
+
+    // Pixel classes after non-maximum suppression
+    constexpr uint8_t NONE = 0;
+    constexpr uint8_t WEAK = 1;   // Local maximum between the thresholds, an edge only if connected to a strong one
+    constexpr uint8_t STRONG = 2; // Local maximum above the high threshold, or a weak one connected to it
+
+    // Direction of the gradient rounded to a multiple of 45 degrees
+    enum Sector : uint8_t { HORIZONTAL, DIAGONAL, VERTICAL, ANTIDIAGONAL };
+    constexpr uint16_t TAN22_5 = 27146; // tan(22.5 degrees) in 16-bit fixed point
+
+    // The whole pipeline works in 16-bit lanes. Luminance is kept in 8.7 fixed point, so the two
+    // taps on opposite sides can be added before both blur passes multiply them by 16-bit weights,
+    // keeping the high half. The blurred values are then narrowed to 8.4 so that Sobel derivatives
+    // fit into int16 and their squares into int32.
+    constexpr int LUMA_FRACTION = 7;
+    constexpr int BLUR_FRACTION = 4;
+
+    // One side of a 1D Gaussian, weights[0] is the center. They are rounded down and the center
+    // takes the remainder, so that the taps sum to 65535 and the blur can't overflow.
+    int radius = sigma > 0.0 ? static_cast<int>(std::ceil(3.0 * sigma)) : 0;
+    std::vector<uint16_t> weights(radius + 1, 0xffff);
+    if (radius > 0) {
+        std::vector<double> kernel(radius + 1);
+        double sum = 0.0;
+        for (int k = 0; k <= radius; ++k) {
+            kernel[k] = std::exp(-static_cast<double>(k * k) / (2.0 * sigma * sigma));
+            sum += k == 0 ? kernel[k] : 2.0 * kernel[k];
+        }
+        int32_t center = 0xffff;
+        for (int k = 1; k <= radius; ++k) {
+            weights[k] = static_cast<uint16_t>(kernel[k] / sum * 0xffff);
+            center -= 2 * weights[k];
+        }
+        weights[0] = static_cast<uint16_t>(center);
+    }
 
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            double rSum = 0, gSum = 0, bSum = 0;
+    auto mulHigh = [](uint16_t value, uint16_t weight) {
+        return static_cast<uint16_t>((uint32_t(value) * weight) >> 16);
+    };
+
+    // Thresholds on the squared magnitude, in the units of the 8.4 derivatives
+    auto squaredThreshold = [](int threshold) {
+        int64_t scaled = int64_t(std::max(threshold, 0)) << BLUR_FRACTION;
+        return static_cast<int32_t>(std::min<int64_t>(scaled * scaled, std::numeric_limits<int32_t>::max()));
+    };
+    int32_t low = squaredThreshold(lowThreshold);
+    int32_t high = squaredThreshold(highThreshold);
+
+    // Every pixel is classified by the band it belongs to, so the buffer needs no clearing
+    std::unique_ptr<uint8_t[]> classes(new uint8_t[size_t(width) * height]);
+    auto index = [width](int x, int y) { return qsizetype(y) * width + x; };
+
+    QImage result(width, height, QImage::Format_ARGB32);
+    uchar* resultBits = result.bits();
+    qsizetype resultStride = result.bytesPerLine();
+    auto resultPixel = [&](int x, int y) -> QRgb& { return reinterpret_cast<QRgb*>(resultBits + y * resultStride)[x]; };
+
+    // Turn weak pixels 8-connected to the ones on the stack into strong ones, looking only at rows [yBegin; yEnd)
+    auto flood = [&](std::vector<qsizetype>& stack, int yBegin, int yEnd) {
+        while (!stack.empty()) {
+            qsizetype i = stack.back();
+            stack.pop_back();
+
+            int x = int(i % width);
+            int y = int(i / width);
+
+            for (int ny = std::max(y - 1, yBegin); ny <= std::min(y + 1, yEnd - 1); ++ny) {
+                for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, width - 1); ++nx) {
+                    uint8_t& neighbour = classes[index(nx, ny)];
+                    if (neighbour == WEAK) {
+                        neighbour = STRONG;
+                        resultPixel(nx, ny) = qRgb(255, 255, 255);
+                        stack.push_back(index(nx, ny));
+                    }
+                }
+            }
+        }
+    };
+
+    // A band recomputes the blur and gradient of the radius + 2 rows around it, so bands are
+    // made tall enough for that to stay cheap rather than sized by the cache budget alone
+    int bandRows = std::max(RowBands::bandHeight(source.bytesPerLine(), radius + 2), 16 * (radius + 2));
+
+    // Luminance, blur, gradient and non-maximum suppression run row by row on rings of rows,
+    // then hysteresis follows edges as far as the band goes and the band's rows are written out
+    RowBands::runRows(height, bandRows, [&](int yBegin, int yEnd) {
+        // Luminance of the rows the vertical blur reads
+        int lumaCount = 2 * radius + 1;
+        std::vector<uint16_t> lumaRows(size_t(width) * lumaCount);
+        std::vector<uint16_t> columnSums(width + 2 * radius);
+        std::vector<uint16_t> rowSums(width);
+
+        // Blurred luminance, padded with a copy of the edge pixels
+        qsizetype blurStride = width + 2;
+        std::vector<int16_t> blurRows(blurStride * 3);
+
+        // Squared gradient magnitude, padded with zeros, and its direction
+        qsizetype magnitudeStride = width + 2;
+        std::vector<int32_t> magnitudeRows(magnitudeStride * 3, 0);
+        std::vector<uint8_t> sectorRows(size_t(width) * 3);
+
+        auto ring = [](int row, int size) { return (row % size + size) % size; };
+        auto luma = [&](int row) { return lumaRows.data() + ring(row, lumaCount) * width; };
+        auto blurred = [&](int row) { return blurRows.data() + ring(row, 3) * blurStride + 1; };
+        auto magnitudes = [&](int row) { return magnitudeRows.data() + ring(row, 3) * magnitudeStride + 1; };
+        auto sectors = [&](int row) { return sectorRows.data() + ring(row, 3) * width; };
+
+        // Rows are converted as the blur first needs them, rows outside of the image repeat the edge ones
+        int nextLuma = yBegin - 2 - radius;
+        auto loadLuma = [&](int lastRow) {
+            for (; nextLuma <= lastRow; ++nextLuma) {
+                const QRgb* in = reinterpret_cast<const QRgb*>(source.constScanLine(std::clamp(nextLuma, 0, height - 1)));
+                uint16_t* out = luma(nextLuma);
+                for (int x = 0; x < width; ++x) {
+                    out[x] = static_cast<uint16_t>(qGray(in[x]) << LUMA_FRACTION);
+                }
+            }
+        };
 
-            for (int ky = -radiusY; ky <= radiusY; ++ky) {
-                for (int kx = -radiusX; kx <= radiusX; ++kx) {
+        auto blur = [&](int row) {
+            loadLuma(row + radius);
 
-                    int nx = std::clamp(x + kx, 0, w - 1);
-                    int ny = std::clamp(y + ky, 0, h - 1);
+            uint16_t* sums = columnSums.data() + radius;
+            const uint16_t* center = luma(row);
+            for (int x = 0; x < width; ++x) {
+                sums[x] = mulHigh(center[x], weights[0]);
+            }
+            for (int k = 1; k <= radius; ++k) {
+                const uint16_t* above = luma(row - k);
+                const uint16_t* below = luma(row + k);
+                uint16_t weight = weights[k];
+                for (int x = 0; x < width; ++x) {
+                    sums[x] += mulHigh(above[x] + below[x], weight);
+                }
+            }
+            std::fill(sums - radius, sums, sums[0]);
+            std::fill(sums + width, sums + width + radius, sums[width - 1]);
+
+            uint16_t* blurredSums = rowSums.data();
+            for (int x = 0; x < width; ++x) {
+                blurredSums[x] = mulHigh(sums[x], weights[0]);
+            }
+            for (int k = 1; k <= radius; ++k) {
+                const uint16_t* left = sums - k;
+                const uint16_t* right = sums + k;
+                uint16_t weight = weights[k];
+                for (int x = 0; x < width; ++x) {
+                    blurredSums[x] += mulHigh(left[x] + right[x], weight);
+                }
+            }
 
-                    QRgb px = src.pixel(nx, ny);
+            int16_t* out = blurred(row);
+            for (int x = 0; x < width; ++x) {
+                out[x] = static_cast<int16_t>(blurredSums[x] >> (LUMA_FRACTION - BLUR_FRACTION));
+            }
+            out[-1] = out[0];
+            out[width] = out[width - 1];
+        };
+
+        // Sobel derivatives of the blurred row, zero magnitude outside of the image. This is the operator
+        // of applyGradientFilter, but on blurred values and with the magnitude left unclamped,
+        // which non-maximum suppression needs. Magnitudes are kept squared: comparisons don't change
+        // and the loop has no square root.
+        auto gradient = [&, width](int row) {
+            int32_t* magnitude = magnitudes(row);
+            if (row < 0 || row >= height) {
+                std::fill(magnitude, magnitude + width, 0);
+                return;
+            }
 
-                    double weight = kernel[ky + radiusY][kx + radiusX];
+            const int16_t* top = blurred(row - 1);
+            const int16_t* center = blurred(row);
+            const int16_t* bottom = blurred(row + 1);
+            uint8_t* sector = sectors(row);
+
+            for (int x = 0; x < width; ++x) {
+                int16_t gx, gy;
+                derivatives3x3(top, center, bottom, x, int16_t(2), gx, gy);
+                magnitude[x] = int32_t(gx) * gx + int32_t(gy) * gy;
+
+                // Branchless, so the loop vectorizes. The derivatives are integers, so comparing
+                // one with the rounded down product of the other and the tangent is exact.
+                uint16_t ax = static_cast<uint16_t>(std::abs(gx));
+                uint16_t ay = static_cast<uint16_t>(std::abs(gy));
+                uint8_t diagonal = (gx > 0) == (gy > 0) ? DIAGONAL : ANTIDIAGONAL;
+                uint8_t steep = ax <= mulHigh(ay, TAN22_5) ? uint8_t(VERTICAL) : diagonal;
+                sector[x] = ay <= mulHigh(ax, TAN22_5) ? uint8_t(HORIZONTAL) : steep;
+            }
+        };
+
+        std::vector<qsizetype> stack;
+
+        // Keep pixels that are the largest along the gradient, the tie goes to the left (upper) one
+        auto suppress = [&](int y) {
+            const int32_t* top = magnitudes(y - 1);
+            const int32_t* center = magnitudes(y);
+            const int32_t* bottom = magnitudes(y + 1);
+            const uint8_t* sector = sectors(y);
+            uint8_t* out = classes.get() + index(0, y);
+
+            for (int x = 0; x < width; ++x) {
+                int32_t m = center[x];
+                out[x] = NONE;
+                if (m < low) continue;
+
+                int32_t before, after;
+                switch (sector[x]) {
+                    case HORIZONTAL:   before = center[x - 1]; after = center[x + 1]; break;
+                    case VERTICAL:     before = top[x];        after = bottom[x];     break;
+                    case DIAGONAL:     before = top[x - 1];    after = bottom[x + 1]; break;
+                    default:           before = top[x + 1];    after = bottom[x - 1]; break;
+                }
+                if (m <= before || m < after) continue;
 
-                    rSum += qRed(px) * weight;
-                    gSum += qGreen(px) * weight;
-                    bSum += qBlue(px) * weight;
+                if (m >= high) {
+                    out[x] = STRONG;
+                    stack.push_back(index(x, y));
+                } else {
+                    out[x] = WEAK;
                 }
             }
+        };
+
+        blur(yBegin - 2);
+        blur(yBegin - 1);
+        blur(yBegin);
+        gradient(yBegin - 1);
+        blur(yBegin + 1);
+        gradient(yBegin);
+
+        for (int y = yBegin; y < yEnd; ++y) {
+            blur(y + 2);
+            gradient(y + 1);
+            suppress(y);
+        }
 
-            result.setPixel(x, y, qRgb(
-                std::clamp(static_cast<int>(rSum), 0, 255),
-                std::clamp(static_cast<int>(gSum), 0, 255),
-                std::clamp(static_cast<int>(bSum), 0, 255)
-            ));
+        flood(stack, yBegin, yEnd);
+
+        for (int y = yBegin; y < yEnd; ++y) {
+            const uint8_t* in = classes.get() + index(0, y);
+            QRgb* out = &resultPixel(0, y);
+            for (int x = 0; x < width; ++x) {
+                out[x] = in[x] == STRONG ? qRgb(255, 255, 255) : qRgb(0, 0, 0);
+            }
+        }
+    });
+
+    // Edges crossing a band border were only followed up to it. Every weak pixel left there is
+    // next to a strong one in the neighbouring band's first or last row, so those are enough to continue from.
+    // The flood marks the pixels it turns strong in the result directly.
+    std::vector<qsizetype> stack;
+    for (int border = bandRows; border < height; border += bandRows) {
+        for (int y = border - 1; y <= border; ++y) {
+            for (int x = 0; x < width; ++x) {
+                if (classes[index(x, y)] == STRONG) stack.push_back(index(x, y));
+            }
         }
     }
+    flood(stack, 0, height);
+
     return result;
 }
 
-QImage ImageProcessor::applyGlassEffect(const QImage& src, int radius) {
-    QImage result = src;
-    int w = src.width();
-    int h = src.height();
+QImage ImageProcessor::applyKernel(const QImage& src, const Kernel& kernel) {
+    return Convolution(kernel).apply(src);
+}
 
-    std::uniform_int_distribution<int> dist(-radius, radius);
+QImage ImageProcessor::applyGlassEffect(const QImage& src, int radius, uint64_t seed) {
+    if (src.isNull()) return QImage();
 
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            int dx = dist(rng);
-            int dy = dist(rng);
+    return DisplacementField::glass(src.size(), radius, seed).apply(src);
+}
 
-            int sx = std::clamp(x + dx, 0, w - 1);
-            int sy = std::clamp(y + dy, 0, h - 1);
+QImage ImageProcessor::applySwirlEffect(const QImage& src, float angle) {
+    if (src.isNull()) return QImage();
 
-            result.setPixel(x, y, src.pixel(sx, sy));
-        }
-    }
+    return DisplacementField::swirl(src.size(), angle).apply(src);
+}
 
-    return result;
+QImage ImageProcessor::applyRippleEffect(const QImage& src, float amplitude, float wavelength) {
+    if (src.isNull()) return QImage();
+
+    return DisplacementField::ripple(src.size(), amplitude, wavelength).apply(src);
+}
+
+QImage ImageProcessor::applyWaveEffect(const QImage& src, float amplitude, float wavelength) {
+    if (src.isNull()) return QImage();
+
+    return DisplacementField::wave(src.size(), amplitude, wavelength).apply(src);
 }
 
 
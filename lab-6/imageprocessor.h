@@ -4,9 +4,10 @@
 #include <QImage>
 #include <QObject>
 
-#include <random>
+#include <cstdint>
+#include <vector>
 
-using Kernel = std::vector<std::vector<double>>;
+#include "convolution.h"
 
 class ImageProcessor : public QObject
 {
@@ -15,10 +16,22 @@ class ImageProcessor : public QObject
 public:
     ImageProcessor();
 
-    static QImage applySpotNoise(const QImage& src, int dotCount);
-    static QImage applyLineNoise(const QImage& src, int lineCount);
-    static QImage applyCircleNoise(const QImage& src, int circleCount);
-    static QImage applyMedianFilter(const QImage& src, int kernelSize);
+    // How the median filter picks its output
+    enum class MedianMode {
+        Luminance, // Whole pixel whose luminance is the median of the window
+        PerChannel // Median of each color channel taken separately
+    };
+
+    // Noise generators and the glass effect draw their random numbers from CounterRng:
+    // the same seed gives the same image, however the work is split between threads
+    static QImage applySpotNoise(const QImage& src, int dotCount, uint64_t seed);
+    static QImage applyLineNoise(const QImage& src, int lineCount, uint64_t seed);
+    static QImage applyCircleNoise(const QImage& src, int circleCount, uint64_t seed);
+    // Normally distributed noise with the given standard deviation added to every channel
+    static QImage applyGaussianNoise(const QImage& src, double sigma, uint64_t seed);
+    // The given fraction of pixels turned black or white
+    static QImage applySaltAndPepperNoise(const QImage& src, double density, uint64_t seed);
+    static QImage applyMedianFilter(const QImage& src, int kernelSize, MedianMode mode = MedianMode::Luminance);
     static QImage applyGaussianFilter(const QImage& src, int kernelSize);
 
     static QImage applyBasicSharpeningFilter(const QImage& src, int k);
@@ -27,16 +40,50 @@ public:
     static QImage applyRobertsFilter(const QImage& src, int k);
     static QImage applyLaplacian(const QImage& src, int k);
 
-    static QImage applyGlassEffect(const QImage& src, int radius);
+    // Geometric effects, each a DisplacementField applied once. To apply the same effect
+    // to several images, generate the field through DisplacementField and keep it.
+    static QImage applyGlassEffect(const QImage& src, int radius, uint64_t seed);
+    static QImage applySwirlEffect(const QImage& src, float angle);
+    static QImage applyRippleEffect(const QImage& src, float amplitude, float wavelength);
+    static QImage applyWaveEffect(const QImage& src, float amplitude, float wavelength);
+
+    // Derivative operators of the edge filters
+    enum class GradientOperator {
+        Sobel,   // 3x3, middle row/column weighted twice
+        Prewitt, // 3x3, uniform weights
+        Roberts  // 2x2 diagonal differences
+    };
+
+    // Luminance gradient magnitude times k / 20 added to every color channel, in a single pass over the image.
+    // If orientation is given it receives the gradient direction atan2(gy, gx), mapped from [-pi; pi] to [0; 255];
+    // it is only computed then, so the filters themselves pay nothing for it.
+    static QImage applyGradientFilter(const QImage& src, GradientOperator op, int k, QImage* orientation = nullptr);
+
+    // Canny edge detector: white one-pixel-wide edges on black. The luminance is blurred with a Gaussian
+    // of the given sigma (none if it's 0), edges are the local maxima of the Sobel gradient magnitude
+    // along its direction that are above highThreshold or connected to such through ones above lowThreshold.
+    static QImage applyCannyFilter(const QImage& src, double sigma, int lowThreshold, int highThreshold);
 
 private:
-    static QImage addWeighted(const QImage& src1, double alpha, const QImage& src2, double beta, double gamma);
     static QImage applyKernel(const QImage& src, const Kernel& aperture);
-    static QImage applyEdgeDetection(const QImage& src, const Kernel& kx, const Kernel& ky);
+    // Constant-time per-channel median through sliding histograms
+    static QImage applyPerChannelMedianFilter(const QImage& src, int radius);
 
-private:
-    static std::random_device rd;
-    static std::mt19937 rng;
+    // Convolve each row with a symmetric 1D fixed-point kernel, writing row y into column y of dst
+    static void convolveRowsTransposed(const QImage& src, QImage& dst, const std::vector<int32_t>& weights);
+    // Same as above, but with a box kernel computed through running sums
+    static void boxFilterRowsTransposed(const QImage& src, QImage& dst, int radius);
+    // Radii of box filters that approximate a Gaussian when applied one after another
+    static std::vector<int> boxCascadeRadii(double sigma, int passes);
+
+    static constexpr int WEIGHT_BITS = 16;               // Fixed-point precision of filter weights
+    static constexpr int GAUSSIAN_BOX_CASCADE_SIZE = 25; // Gaussian kernels this large are approximated with boxes
+
+    // CounterRng streams of the values drawn for one counter
+    static constexpr uint32_t NOISE_X = 0;     // Horizontal position or offset
+    static constexpr uint32_t NOISE_Y = 1;     // Vertical position or offset
+    static constexpr uint32_t NOISE_VALUE = 2; // Anything else (radius, noise level); takes two streams
+    static constexpr float NOISE_PEN_WIDTH = 2.0f; // Lines and circles of the noise generators
 };
 
 #endif // IMAGEPROCESSOR_H
@@ -3,6 +3,8 @@
 
 #include "imageprocessor.h"
 
+#include <limits>
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
@@ -59,25 +61,43 @@ void MainWindow::setupUI() {
 
     QPushButton *dotButton = new QPushButton("Точки");
     connect(dotButton, &QPushButton::clicked, this, [this](){
-        m_processedImage = ImageProcessor::applySpotNoise(m_processedImage, m_noiseIntensitySlider->value() * 100);
+        m_processedImage = ImageProcessor::applySpotNoise(m_processedImage, m_noiseIntensitySlider->value() * 100, nextSeed());
         updateImage();
     });
     noiseSelectionLayout->addWidget(dotButton);
 
     QPushButton *lineButton = new QPushButton("Линии");
     connect(lineButton, &QPushButton::clicked, this, [this](){
-        m_processedImage = ImageProcessor::applyLineNoise(m_processedImage, m_noiseIntensitySlider->value() * 2);
+        m_processedImage = ImageProcessor::applyLineNoise(m_processedImage, m_noiseIntensitySlider->value() * 2, nextSeed());
         updateImage();
     });
     noiseSelectionLayout->addWidget(lineButton);
 
     QPushButton *circleButton = new QPushButton("Окружности");
     connect(circleButton, &QPushButton::clicked, this, [this](){
-        m_processedImage = ImageProcessor::applyCircleNoise(m_processedImage, m_noiseIntensitySlider->value() * 10);
+        m_processedImage = ImageProcessor::applyCircleNoise(m_processedImage, m_noiseIntensitySlider->value() * 10, nextSeed());
         updateImage();
     });
     noiseSelectionLayout->addWidget(circleButton);
 
+    QHBoxLayout *noiseDistributionLayout = new QHBoxLayout();
+
+    QPushButton *gaussianButton = new QPushButton("Гауссов");
+    connect(gaussianButton, &QPushButton::clicked, this, [this](){
+        // Intensity is the standard deviation in brightness levels
+        m_processedImage = ImageProcessor::applyGaussianNoise(m_processedImage, m_noiseIntensitySlider->value(), nextSeed());
+        updateImage();
+    });
+    noiseDistributionLayout->addWidget(gaussianButton);
+
+    QPushButton *saltAndPepperButton = new QPushButton("Соль и перец");
+    connect(saltAndPepperButton, &QPushButton::clicked, this, [this](){
+        // Intensity is the share of affected pixels in tenths of a percent
+        m_processedImage = ImageProcessor::applySaltAndPepperNoise(m_processedImage, m_noiseIntensitySlider->value() / 1000.0, nextSeed());
+        updateImage();
+    });
+    noiseDistributionLayout->addWidget(saltAndPepperButton);
+
     QHBoxLayout *noiseIntensityLayout = new QHBoxLayout();
     QLabel *noiseIntensityValue = new QLabel("10");
 
@@ -93,8 +113,23 @@ void MainWindow::setupUI() {
 
     noiseLayout->addWidget(new QLabel("Тип накладываемого шума:"));
     noiseLayout->addLayout(noiseSelectionLayout);
+    noiseLayout->addLayout(noiseDistributionLayout);
     noiseLayout->addLayout(noiseIntensityLayout);
     noiseLayout->addWidget(m_noiseIntensitySlider);
+
+    // Seed of the noise and the glass effect, a fresh one is drawn for every application unless it's fixed
+    QHBoxLayout *seedLayout = new QHBoxLayout();
+
+    m_seedInput = new QSpinBox();
+    m_seedInput->setRange(0, std::numeric_limits<int>::max());
+    m_seedInput->setValue(0);
+
+    m_fixedSeedBox = new QCheckBox("Фиксированное зерно");
+
+    seedLayout->addWidget(new QLabel("Зерно: "));
+    seedLayout->addWidget(m_seedInput);
+    seedLayout->addWidget(m_fixedSeedBox);
+    noiseLayout->addLayout(seedLayout);
     rightLayout->addWidget(noiseGroup);
 
     // Noise reduction
@@ -102,13 +137,13 @@ void MainWindow::setupUI() {
     QVBoxLayout *noiseReductionLayout = new QVBoxLayout(noiseReductionGroup);
 
     m_noiseReductionBox = new QComboBox();
-    m_noiseReductionBox->addItems({"Медианный фильтр", "Фильтр Гаусса"});
+    m_noiseReductionBox->addItems({"Медианный фильтр", "Медианный фильтр (по каналам)", "Фильтр Гаусса"});
 
     QHBoxLayout *apertureLayout = new QHBoxLayout();
     QLabel *apertureValue = new QLabel("3");
 
     m_apertureSlider = new QSlider(Qt::Horizontal);
-    m_apertureSlider->setRange(3, 15);
+    m_apertureSlider->setRange(3, 31);
     m_apertureSlider->setValue(3);
     m_apertureSlider->setSingleStep(2);
     connect(m_apertureSlider, &QSlider::valueChanged, this, [this, apertureValue](){
@@ -159,32 +194,103 @@ void MainWindow::setupUI() {
 
     rightLayout->addWidget(sharpeningGroup);
 
+    // Edge detection
+    QGroupBox *edgeGroup = new QGroupBox("Выделение границ (Канни)");
+    QVBoxLayout *edgeLayout = new QVBoxLayout(edgeGroup);
+
+    QHBoxLayout *blurValueLayout = new QHBoxLayout();
+    QLabel *blurValue = new QLabel("1.4");
+
+    blurValueLayout->addWidget(new QLabel("Размытие (σ): "));
+    blurValueLayout->addWidget(blurValue, Qt::AlignLeft);
+
+    QSlider *blurSlider = new QSlider(Qt::Horizontal);
+    blurSlider->setRange(0, 50); // Tenths of sigma
+    blurSlider->setValue(14);
+    connect(blurSlider, &QSlider::valueChanged, this, [blurSlider, blurValue]{
+        blurValue->setText(QString::number(blurSlider->value() / 10.0, 'f', 1));
+    });
+
+    QHBoxLayout *lowThresholdLayout = new QHBoxLayout();
+    QLabel *lowThresholdValue = new QLabel("50");
+
+    lowThresholdLayout->addWidget(new QLabel("Нижний порог: "));
+    lowThresholdLayout->addWidget(lowThresholdValue, Qt::AlignLeft);
+
+    QSlider *lowThresholdSlider = new QSlider(Qt::Horizontal);
+    lowThresholdSlider->setRange(0, 1000);
+    lowThresholdSlider->setValue(50);
+
+    QHBoxLayout *highThresholdLayout = new QHBoxLayout();
+    QLabel *highThresholdValue = new QLabel("150");
+
+    highThresholdLayout->addWidget(new QLabel("Верхний порог: "));
+    highThresholdLayout->addWidget(highThresholdValue, Qt::AlignLeft);
+
+    QSlider *highThresholdSlider = new QSlider(Qt::Horizontal);
+    highThresholdSlider->setRange(0, 1000);
+    highThresholdSlider->setValue(150);
+
+    // Keep low <= high by dragging the other slider along
+    connect(lowThresholdSlider, &QSlider::valueChanged, this, [lowThresholdSlider, highThresholdSlider, lowThresholdValue]{
+        lowThresholdValue->setText(QString("%1").arg(lowThresholdSlider->value()));
+        if (highThresholdSlider->value() < lowThresholdSlider->value()) {
+            highThresholdSlider->setValue(lowThresholdSlider->value());
+        }
+    });
+    connect(highThresholdSlider, &QSlider::valueChanged, this, [lowThresholdSlider, highThresholdSlider, highThresholdValue]{
+        highThresholdValue->setText(QString("%1").arg(highThresholdSlider->value()));
+        if (lowThresholdSlider->value() > highThresholdSlider->value()) {
+            lowThresholdSlider->setValue(highThresholdSlider->value());
+        }
+    });
+
+    QPushButton *applyEdgeButton = new QPushButton("Выделить границы");
+    connect(applyEdgeButton, &QPushButton::clicked, this, [this, blurSlider, lowThresholdSlider, highThresholdSlider](){
+        if (m_processedImage.isNull()) return;
+        m_processedImage = ImageProcessor::applyCannyFilter(m_processedImage, blurSlider->value() / 10.0,
+                                                            lowThresholdSlider->value(), highThresholdSlider->value());
+        updateImage();
+    });
+
+    edgeLayout->addLayout(blurValueLayout);
+    edgeLayout->addWidget(blurSlider);
+    edgeLayout->addLayout(lowThresholdLayout);
+    edgeLayout->addWidget(lowThresholdSlider);
+    edgeLayout->addLayout(highThresholdLayout);
+    edgeLayout->addWidget(highThresholdSlider);
+    edgeLayout->addWidget(applyEdgeButton);
+
+    rightLayout->addWidget(edgeGroup);
+
     // Effect
     QGroupBox *effectGroup = new QGroupBox("Спецэффект");
     QVBoxLayout *effectLayout = new QVBoxLayout(effectGroup);
 
+    m_effectBox = new QComboBox();
+    m_effectBox->addItems({"Стекло", "Водоворот", "Рябь", "Волны"});
+
     QHBoxLayout *effectValueLayout = new QHBoxLayout();
 
     QLabel *effectRadiusValue = new QLabel("3");
 
-    effectValueLayout->addWidget(new QLabel("Радиус искажения: "));
+    effectValueLayout->addWidget(new QLabel("Сила искажения: "));
     effectValueLayout->addWidget(effectRadiusValue, Qt::AlignLeft);
 
-    QSlider *effectSlider = new QSlider(Qt::Horizontal);
-    effectSlider->setRange(2, 10);
-    effectSlider->setValue(3);
-    connect(effectSlider, &QSlider::valueChanged, this, [effectSlider, effectRadiusValue]{
-        effectRadiusValue->setText(QString("%1").arg(effectSlider->value()));
+    m_effectSlider = new QSlider(Qt::Horizontal);
+    m_effectSlider->setRange(2, 10);
+    m_effectSlider->setValue(3);
+    connect(m_effectSlider, &QSlider::valueChanged, this, [this, effectRadiusValue]{
+        effectRadiusValue->setText(QString("%1").arg(m_effectSlider->value()));
     });
 
-    QPushButton *applyEffectButton = new QPushButton("Применить эффект стекла");
-    connect(applyEffectButton, &QPushButton::clicked, this, [this, effectSlider](){
-        m_processedImage = ImageProcessor::applyGlassEffect(m_processedImage, effectSlider->value());
-        updateImage();
-    });
+    QPushButton *applyEffectButton = new QPushButton("Применить эффект");
+    connect(applyEffectButton, &QPushButton::clicked, this, &MainWindow::applyEffect);
 
+    effectLayout->addWidget(new QLabel("Эффект:"));
+    effectLayout->addWidget(m_effectBox);
     effectLayout->addLayout(effectValueLayout);
-    effectLayout->addWidget(effectSlider);
+    effectLayout->addWidget(m_effectSlider);
     effectLayout->addWidget(applyEffectButton);
 
     rightLayout->addWidget(effectGroup);
@@ -231,6 +337,9 @@ void MainWindow::applyNoiseFilter() {
 
     if (filter == 0) { // Median filter
         m_processedImage = ImageProcessor::applyMedianFilter(m_processedImage, kernelSize);
+    } else if (filter == 1) { // Per-channel median filter
+        m_processedImage = ImageProcessor::applyMedianFilter(m_processedImage, kernelSize,
+                                                             ImageProcessor::MedianMode::PerChannel);
     } else { // Gaussian filter
         m_processedImage = ImageProcessor::applyGaussianFilter(m_processedImage, kernelSize);
     }
@@ -272,6 +381,44 @@ void MainWindow::updateImage() {
     }
 }
 
+void MainWindow::applyEffect() {
+    if (m_processedImage.isNull()) return;
+
+    int effect = m_effectBox->currentIndex();
+    int strength = m_effectSlider->value();
+    quint64 seed = effect == 0 ? nextSeed() : 0; // Only the glass is random
+    QSize size = m_processedImage.size();
+
+    // Applying the same effect again reuses its field
+    bool cached = !m_effectField.isNull() && m_effectField.size() == size
+                  && m_effectFieldKind == effect && m_effectFieldStrength == strength && m_effectFieldSeed == seed;
+
+    if (!cached) {
+        switch (effect) {
+            case 0:  m_effectField = DisplacementField::glass(size, strength, seed);             break;
+            case 1:  m_effectField = DisplacementField::swirl(size, strength * 0.5f);            break;
+            case 2:  m_effectField = DisplacementField::ripple(size, strength, strength * 6.0f); break;
+            default: m_effectField = DisplacementField::wave(size, strength, strength * 10.0f);  break;
+        }
+
+        m_effectFieldKind = effect;
+        m_effectFieldStrength = strength;
+        m_effectFieldSeed = seed;
+    }
+
+    m_processedImage = m_effectField.apply(m_processedImage);
+    updateImage();
+}
+
+quint64 MainWindow::nextSeed() {
+    if (!m_fixedSeedBox->isChecked()) {
+        // Shown in the spin box, so a result worth repeating can be fixed afterwards
+        m_seedInput->setValue(std::uniform_int_distribution<int>(0, m_seedInput->maximum())(m_seedSource));
+    }
+
+    return m_seedInput->value();
+}
+
 void MainWindow::resetImage() {
     if (m_originalImage.isNull()) return;
 
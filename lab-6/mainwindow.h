@@ -20,6 +20,11 @@
 #include <QTimer>
 #include <QLabel>
 #include <QCheckBox>
+#include <QSpinBox>
+
+#include <random>
+
+#include "displacementfield.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -42,11 +47,14 @@ private slots:
     void loadImage();
     void applyNoiseFilter();
     void applySharpeningFilter();
+    void applyEffect();
 
 private:
     void setupUI();
     void updateImage();
     void resetImage();
+    // Seed for the next noise or effect application
+    quint64 nextSeed();
 
 private:
     Ui::MainWindow *ui;
@@ -63,5 +71,16 @@ private:
     QComboBox *m_noiseReductionBox;
     QComboBox *m_sharpeningMethodBox;
     QSlider *m_sharpeningSlider;
+    QSpinBox *m_seedInput;
+    QCheckBox *m_fixedSeedBox;
+    std::mt19937 m_seedSource{ std::random_device{}() };
+    QComboBox *m_effectBox;
+    QSlider *m_effectSlider;
+
+    // Field of the last applied effect and what it was generated for
+    DisplacementField m_effectField;
+    int m_effectFieldKind = -1;
+    int m_effectFieldStrength = 0;
+    quint64 m_effectFieldSeed = 0;
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,200 @@
+#include "primitiverasterizer.h"
+#include "rowbands.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Move every channel of the pixel towards 255 by the covered fraction
+inline void blendWhite(QRgb& pixel, float coverage) {
+    int alpha = static_cast<int>(coverage * 255.0f + 0.5f);
+    if (alpha <= 0) return;
+    if (alpha >= 255) {
+        pixel = 0xffffffff;
+        return;
+    }
+
+    QRgb result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        int c = (pixel >> shift) & 0xff;
+        c += ((255 - c) * alpha + 127) / 255;
+        result |= QRgb(c) << shift;
+    }
+    pixel = result;
+}
+
+} // namespace
+
+PrimitiveRasterizer::PrimitiveRasterizer(float penWidth)
+    : m_penWidth(penWidth)
+{
+}
+
+void PrimitiveRasterizer::addLine(const QPointF& p1, const QPointF& p2) {
+    m_primitives.push_back({ Primitive::Line, p1, p2 });
+}
+
+void PrimitiveRasterizer::addCircle(const QPointF& center, float radius) {
+    m_primitives.push_back({ Primitive::Circle, center, QPointF(radius, 0.0) });
+}
+
+void PrimitiveRasterizer::verticalExtent(const Primitive& primitive, int& top, int& bottom) const {
+    // The pen reaches at most penWidth / 2 * sqrt(2) across a line, penWidth is a safe margin
+    if (primitive.kind == Primitive::Line) {
+        top = static_cast<int>(std::floor(std::min(primitive.a.y(), primitive.b.y()) - m_penWidth));
+        bottom = static_cast<int>(std::ceil(std::max(primitive.a.y(), primitive.b.y()) + m_penWidth));
+    } else {
+        double reach = primitive.b.x() + m_penWidth;
+        top = static_cast<int>(std::floor(primitive.a.y() - reach));
+        bottom = static_cast<int>(std::ceil(primitive.a.y() + reach));
+    }
+}
+
+void PrimitiveRasterizer::draw(QImage& image) const {
+    int width = image.width();
+    int height = image.height();
+    if (m_primitives.empty() || width <= 0 || height <= 0) return;
+
+    // Indices of the primitives touching each tile, in the order they were added
+    int tileCount = (height + TILE_ROWS - 1) / TILE_ROWS;
+    std::vector<std::vector<int>> tiles(tileCount);
+    for (int i = 0; i < int(m_primitives.size()); ++i) {
+        int top, bottom;
+        verticalExtent(m_primitives[i], top, bottom);
+        if (bottom < 0 || top >= height) continue;
+
+        int firstTile = std::max(top, 0) / TILE_ROWS;
+        int lastTile = std::min(bottom, height - 1) / TILE_ROWS;
+        for (int tile = firstTile; tile <= lastTile; ++tile) {
+            tiles[tile].push_back(i);
+        }
+    }
+
+    uchar* bits = image.bits();
+    qsizetype stride = image.bytesPerLine();
+
+    // A band may start or end inside a tile, its primitives are clipped to the rows both share
+    RowBands::run(height, stride, 0, [&](int yBegin, int yEnd) {
+        for (int tile = yBegin / TILE_ROWS; tile * TILE_ROWS < yEnd; ++tile) {
+            int rowBegin = std::max(yBegin, tile * TILE_ROWS);
+            int rowEnd = std::min(yEnd, (tile + 1) * TILE_ROWS);
+
+            for (int i : tiles[tile]) {
+                const Primitive& primitive = m_primitives[i];
+                if (primitive.kind == Primitive::Line) {
+                    drawLine(primitive, bits, stride, width, rowBegin, rowEnd);
+                } else {
+                    drawCircle(primitive, bits, stride, width, rowBegin, rowEnd);
+                }
+            }
+        }
+    });
+}
+
+void PrimitiveRasterizer::drawLine(const Primitive& line, uchar* bits, qsizetype stride, int width, int yBegin, int yEnd) const {
+    float x0 = line.a.x(), y0 = line.a.y();
+    float x1 = line.b.x(), y1 = line.b.y();
+    float half = m_penWidth / 2.0f;
+
+    // Walk the major axis one pixel at a time. For every step the pen covers an interval of the
+    // minor axis [center - reach; center + reach], pixels get the length of their overlap with it.
+    // The caps cut that interval where the projection onto the line leaves [-half; length + half].
+    bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+    if (steep) {
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+    }
+    if (x0 > x1) {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+
+    float length = std::hypot(x1 - x0, y1 - y0);
+    float ux = length > 0.0f ? (x1 - x0) / length : 1.0f; // Direction, ux >= |uy|
+    float uy = length > 0.0f ? (y1 - y0) / length : 0.0f;
+
+    float slope = uy / ux;
+    float reach = half / ux;
+
+    // Major coordinates of pixel centers between the outermost corners of the caps
+    float capReach = half * (ux + std::abs(uy));
+    int majorBegin = static_cast<int>(std::ceil(x0 - capReach - 0.5f));
+    int majorEnd = static_cast<int>(std::ceil(x1 + capReach - 0.5f));
+
+    // Minor coordinates the image allows: rows [yBegin; yEnd) or all columns
+    int minorBegin = steep ? 0 : yBegin;
+    int minorEnd = steep ? width : yEnd;
+
+    if (steep) {
+        majorBegin = std::max(majorBegin, yBegin);
+        majorEnd = std::min(majorEnd, yEnd);
+    } else {
+        // Only the columns where the pen crosses rows [yBegin; yEnd)
+        if (slope != 0.0f) {
+            float xTop = x0 + (yBegin - reach - y0) / slope;
+            float xBottom = x0 + (yEnd + reach - y0) / slope;
+            if (xTop > xBottom) std::swap(xTop, xBottom);
+            majorBegin = std::max(majorBegin, static_cast<int>(std::floor(xTop)) - 1);
+            majorEnd = std::min(majorEnd, static_cast<int>(std::ceil(xBottom)) + 1);
+        }
+        majorBegin = std::max(majorBegin, 0);
+        majorEnd = std::min(majorEnd, width);
+    }
+
+    for (int major = majorBegin; major < majorEnd; ++major) {
+        float along = major + 0.5f - x0;
+        float center = y0 + along * slope;
+        float low = center - reach;
+        float high = center + reach;
+
+        if (uy != 0.0f) {
+            float capLow = y0 + (-half - along * ux) / uy;
+            float capHigh = y0 + (length + half - along * ux) / uy;
+            if (capLow > capHigh) std::swap(capLow, capHigh);
+            low = std::max(low, capLow);
+            high = std::min(high, capHigh);
+        } else if (along < -half || along > length + half) {
+            continue;
+        }
+
+        int minorFirst = std::max(minorBegin, static_cast<int>(std::floor(low)));
+        int minorLast = std::min(minorEnd, static_cast<int>(std::ceil(high)));
+        for (int minor = minorFirst; minor < minorLast; ++minor) {
+            float coverage = std::min(minor + 1.0f, high) - std::max(float(minor), low);
+            int x = steep ? minor : major;
+            int y = steep ? major : minor;
+            blendWhite(reinterpret_cast<QRgb*>(bits + y * stride)[x], coverage);
+        }
+    }
+}
+
+void PrimitiveRasterizer::drawCircle(const Primitive& circle, uchar* bits, qsizetype stride, int width, int yBegin, int yEnd) const {
+    float cx = circle.a.x(), cy = circle.a.y();
+    float radius = circle.b.x();
+    float half = m_penWidth / 2.0f;
+
+    // Scanline through the ring: a pixel is covered by how far its center is inside the pen,
+    // measured radially, give or take half a pixel
+    float reach = radius + half + 0.5f;
+
+    int rowBegin = std::max(yBegin, static_cast<int>(std::floor(cy - reach)));
+    int rowEnd = std::min(yEnd, static_cast<int>(std::ceil(cy + reach)));
+
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        float dy = y + 0.5f - cy;
+        if (std::abs(dy) >= reach) continue;
+
+        float span = std::sqrt(reach * reach - dy * dy);
+        int columnBegin = std::max(0, static_cast<int>(std::floor(cx - span)));
+        int columnEnd = std::min(width, static_cast<int>(std::ceil(cx + span)));
+
+        QRgb* row = reinterpret_cast<QRgb*>(bits + y * stride);
+        for (int x = columnBegin; x < columnEnd; ++x) {
+            float dx = x + 0.5f - cx;
+            float distance = std::sqrt(dx * dx + dy * dy);
+            float coverage = std::clamp(half + 0.5f - std::abs(distance - radius), 0.0f, 1.0f);
+            blendWhite(row[x], coverage);
+        }
+    }
+}
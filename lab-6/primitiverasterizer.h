@@ -0,0 +1,51 @@
+#ifndef PRIMITIVERASTERIZER_H
+#define PRIMITIVERASTERIZER_H
+
+#include <QImage>
+#include <QPointF>
+
+#include <vector>
+
+// Antialiased white lines and circle outlines drawn straight into QRgb scanlines, a replacement for
+// QPainter when there are thousands of them. Primitives are collected first and bucketed by the
+// tiles of TILE_ROWS rows they touch; each row band then draws only its tiles' primitives, clipped
+// to its rows, so bands never write the same pixel and run in parallel. Coverage follows QPainter's
+// conventions: pixel (x, y) is the square [x; x + 1) x [y; y + 1), the pen is centered on the
+// geometry and lines get square caps. A pixel covered by fraction a becomes c + (255 - c) * a in
+// every channel, alpha included; primitives over one pixel are blended in the order they were added.
+class PrimitiveRasterizer
+{
+public:
+    explicit PrimitiveRasterizer(float penWidth);
+
+    void reserve(int count) { m_primitives.reserve(count); }
+
+    // Lines are rasterized along their major axis like Bresenham's, with Wu-style coverage
+    // of the pen across it instead of a single pixel per step
+    void addLine(const QPointF& p1, const QPointF& p2);
+    void addCircle(const QPointF& center, float radius);
+
+    // Draw everything added so far into an image of Format_ARGB32
+    void draw(QImage& image) const;
+
+private:
+    static constexpr int TILE_ROWS = 32;
+
+    struct Primitive {
+        enum Kind { Line, Circle } kind;
+        QPointF a; // Line start or circle center
+        QPointF b; // Line end, x() is the radius of a circle
+    };
+
+    // Rows [top; bottom] the primitive may touch
+    void verticalExtent(const Primitive& primitive, int& top, int& bottom) const;
+
+    // Rasterize into rows [yBegin; yEnd) of the image
+    void drawLine(const Primitive& line, uchar* bits, qsizetype stride, int width, int yBegin, int yEnd) const;
+    void drawCircle(const Primitive& circle, uchar* bits, qsizetype stride, int width, int yBegin, int yEnd) const;
+
+    float m_penWidth;
+    std::vector<Primitive> m_primitives;
+};
+
+#endif // PRIMITIVERASTERIZER_H
@@ -1,95 +1,726 @@
 #include "imageprocessor.h"
+#include "rowbands.h"
 
-QImage ImageProcessor::applyNearestNeighbourScaling(const QImage& src, float scale) {
-    if (src.isNull()) return QImage();
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__)
+#define SCALER_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCALER_SSE2
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#endif
+
+namespace {
+
+constexpr int WEIGHT_BITS = 8;                           // Bilinear weights are 8.8 fixed point
+constexpr int WEIGHT_ONE = 1 << WEIGHT_BITS;
+constexpr int BLEND_SHIFT = 2 * WEIGHT_BITS;             // Horizontal and vertical weight multiplied
+constexpr int BLEND_ROUNDING = 1 << (BLEND_SHIFT - 1);
+
+// Source pixel and weight of its next neighbour for one destination column or row.
+// At the last source pixel the tap moves one back and puts the full weight on the neighbour,
+// so index + 1 stays inside the image whenever it is at least 2 pixels large.
+struct Tap {
+    int index;
+    int weight;
+};
+
+Tap bilinearTap(int i, int srcSize, int dstSize) {
+    int64_t denominator = std::max(dstSize - 1, 1);
+
+    // Corners of the source and destination are aligned, as (srcSize - 1) / (dstSize - 1)
+    int64_t position = int64_t(i) * (srcSize - 1) * WEIGHT_ONE / denominator;
+    Tap tap = { int(position >> WEIGHT_BITS), int(position & (WEIGHT_ONE - 1)) };
+
+    if (tap.index >= srcSize - 1 && srcSize > 1) {
+        tap = { srcSize - 2, WEIGHT_ONE };
+    }
+
+    return tap;
+}
+
+// Taps of destination columns or rows [begin; end)
+std::vector<Tap> bilinearTaps(int srcSize, int dstSize, int begin, int end) {
+    std::vector<Tap> taps(end - begin);
+
+    for (int i = begin; i < end; ++i) {
+        taps[i - begin] = bilinearTap(i, srcSize, dstSize);
+    }
+
+    return taps;
+}
+
+// Source pixel of a destination column or row, as (dstIndex * srcSize / dstSize)
+int nearestTap(int i, int srcSize, int dstSize) {
+    float ratio = static_cast<float>(srcSize) / dstSize;
+    return std::min(static_cast<int>(i * ratio), srcSize - 1);
+}
+
+std::vector<int> nearestTaps(int srcSize, int dstSize, int begin, int end) {
+    std::vector<int> taps(end - begin);
+
+    for (int i = begin; i < end; ++i) {
+        taps[i - begin] = nearestTap(i, srcSize, dstSize);
+    }
+
+    return taps;
+}
+
+// Blend two horizontally interpolated channel values with the vertical weight
+inline int blendChannel(int top, int bottom, int weight) {
+    return (top * (WEIGHT_ONE - weight) + bottom * weight + BLEND_ROUNDING) >> BLEND_SHIFT;
+}
+
+#if defined(SCALER_SSE2) || defined(SCALER_AVX2)
+// a * b for 32-bit lanes holding non-negative values
+inline __m128i mulLo32(__m128i a, __m128i b) {
+#if defined(__SSE4_1__)
+    return _mm_mullo_epi32(a, b);
+#else
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+}
+
+// Interpolate one destination pixel horizontally: the source pixel and its neighbour are
+// loaded together and interleaved per channel, so a single multiply-add weights all four channels
+inline __m128i interpolatePixel(const QRgb* src, const Tap& tap) {
+    __m128i pair = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + tap.index));
+    pair = _mm_unpacklo_epi8(pair, _mm_setzero_si128());     // a0 a1 a2 a3 b0 b1 b2 b3
+    pair = _mm_unpacklo_epi16(pair, _mm_srli_si128(pair, 8)); // a0 b0 a1 b1 a2 b2 a3 b3
+    __m128i weights = _mm_set1_epi32((tap.weight << 16) | (WEIGHT_ONE - tap.weight));
+    return _mm_madd_epi16(pair, weights);
+}
+#endif
+
+// Interpolate a source row at every destination column, 4 channels of 32 bits per pixel
+void interpolateRow(const QRgb* src, const Tap* taps, int count, int32_t* dst) {
+    int x = 0;
+
+#if defined(SCALER_AVX2)
+    for (; x + 2 <= count; x += 2) {
+        __m128i first = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + taps[x].index));
+        __m128i second = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + taps[x + 1].index));
+
+        // Each 128-bit lane holds one destination pixel
+        __m256i pair = _mm256_cvtepu8_epi16(_mm_unpacklo_epi64(first, second));
+        pair = _mm256_unpacklo_epi16(pair, _mm256_srli_si256(pair, 8));
+
+        __m256i weights = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_set1_epi32((taps[x].weight << 16) | (WEIGHT_ONE - taps[x].weight))),
+            _mm_set1_epi32((taps[x + 1].weight << 16) | (WEIGHT_ONE - taps[x + 1].weight)), 1);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * x), _mm256_madd_epi16(pair, weights));
+    }
+#endif
+
+#if defined(SCALER_SSE2) || defined(SCALER_AVX2)
+    for (; x < count; ++x) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * x), interpolatePixel(src, taps[x]));
+    }
+#else
+    for (; x < count; ++x) {
+        const uchar* a = reinterpret_cast<const uchar*>(src + taps[x].index);
+        const uchar* b = a + sizeof(QRgb);
+
+        for (int c = 0; c < 4; ++c) {
+            dst[4 * x + c] = a[c] * (WEIGHT_ONE - taps[x].weight) + b[c] * taps[x].weight;
+        }
+    }
+#endif
+}
+
+// Blend two interpolated rows with the vertical weight and pack the result into pixels
+void blendRows(const int32_t* top, const int32_t* bottom, int weight, int count, QRgb* dst) {
+    int x = 0;
+
+#if defined(SCALER_AVX2)
+    __m256i topWeight = _mm256_set1_epi32(WEIGHT_ONE - weight);
+    __m256i bottomWeight = _mm256_set1_epi32(weight);
+    __m256i rounding = _mm256_set1_epi32(BLEND_ROUNDING);
+    // Undo the per-lane interleaving of the packs below
+    __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    for (; x + 8 <= count; x += 8) {
+        __m256i pixels[4]; // Two pixels each
+
+        for (int i = 0; i < 4; ++i) {
+            __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(top + 4 * x + 8 * i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bottom + 4 * x + 8 * i));
+            __m256i sum = _mm256_add_epi32(_mm256_mullo_epi32(t, topWeight), _mm256_mullo_epi32(b, bottomWeight));
+            pixels[i] = _mm256_srli_epi32(_mm256_add_epi32(sum, rounding), BLEND_SHIFT);
+        }
+
+        __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(pixels[0], pixels[1]),
+                                             _mm256_packs_epi32(pixels[2], pixels[3]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm256_permutevar8x32_epi32(packed, order));
+    }
+#endif
+
+#if defined(SCALER_SSE2) || defined(SCALER_AVX2)
+    __m128i topWeight4 = _mm_set1_epi32(WEIGHT_ONE - weight);
+    __m128i bottomWeight4 = _mm_set1_epi32(weight);
+    __m128i rounding4 = _mm_set1_epi32(BLEND_ROUNDING);
+
+    for (; x + 4 <= count; x += 4) {
+        __m128i pixels[4]; // One pixel each
+
+        for (int i = 0; i < 4; ++i) {
+            __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + 4 * (x + i)));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + 4 * (x + i)));
+            __m128i sum = _mm_add_epi32(mulLo32(t, topWeight4), mulLo32(b, bottomWeight4));
+            pixels[i] = _mm_srli_epi32(_mm_add_epi32(sum, rounding4), BLEND_SHIFT);
+        }
+
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(pixels[0], pixels[1]),
+                                          _mm_packs_epi32(pixels[2], pixels[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), packed);
+    }
+#endif
+
+    for (; x < count; ++x) {
+        uchar* out = reinterpret_cast<uchar*>(dst + x);
+
+        for (int c = 0; c < 4; ++c) {
+            out[c] = uchar(blendChannel(top[4 * x + c], bottom[4 * x + c], weight));
+        }
+    }
+}
+
+constexpr int FILTER_BITS = 14; // Resampling weights are Q14, negative lobes included
+constexpr int FILTER_ONE = 1 << FILTER_BITS;
+
+// Fixed-point weights of one axis of the resampler, computed once per call.
+// Every destination pixel reads `taps` consecutive source pixels starting at start[i],
+// shorter filters are padded with zero weights.
+struct FilterBank {
+    int taps = 0;
+    std::vector<int> start;
+    std::vector<int16_t> weights; // taps per destination pixel
+};
+
+// Continuous filter kernels, x in source pixels at scale 1
+double cubicKernel(double x, double B, double C) {
+    x = std::abs(x);
+    if (x < 1.0) {
+        return ((12 - 9 * B - 6 * C) * x * x * x + (-18 + 12 * B + 6 * C) * x * x + (6 - 2 * B)) / 6.0;
+    }
+    if (x < 2.0) {
+        return ((-B - 6 * C) * x * x * x + (6 * B + 30 * C) * x * x + (-12 * B - 48 * C) * x + (8 * B + 24 * C)) / 6.0;
+    }
+    return 0.0;
+}
+
+double sinc(double x) {
+    if (x == 0.0) return 1.0;
+    x *= M_PI;
+    return std::sin(x) / x;
+}
+
+double lanczosKernel(double x, int lobes) {
+    return std::abs(x) < lobes ? sinc(x) * sinc(x / lobes) : 0.0;
+}
+
+FilterBank filterBank(int srcSize, int dstSize, ImageProcessor::ResamplingFilter filter) {
+    using Filter = ImageProcessor::ResamplingFilter;
+
+    double scale = double(dstSize) / srcSize;
+    // Downscaling stretches the kernel over 1 / scale source pixels, so it also low-passes
+    double filterScale = std::min(scale, 1.0);
+
+    double support = 0.5;
+    if (filter == Filter::CatmullRom || filter == Filter::Mitchell) support = 2.0;
+    if (filter == Filter::Lanczos3) support = 3.0;
+
+    // Weights per destination pixel over source pixels [first; first + weights.size())
+    std::vector<int> firsts(dstSize);
+    std::vector<std::vector<double>> rows(dstSize);
+    int taps = 1;
+
+    for (int i = 0; i < dstSize; ++i) {
+        std::vector<double>& row = rows[i];
+        int first, last;
+
+        if (filter == Filter::Area) {
+            // Overlap of the destination pixel [i; i + 1) / scale with source pixels [j; j + 1)
+            double left = i / scale;
+            double right = (i + 1) / scale;
+            first = std::clamp(int(std::floor(left)), 0, srcSize - 1);
+            last = std::clamp(int(std::ceil(right)) - 1, first, srcSize - 1);
+
+            for (int j = first; j <= last; ++j) {
+                row.push_back(std::max(0.0, std::min(right, j + 1.0) - std::max(left, double(j))));
+            }
+        } else {
+            // Pixel centers of the source and destination are aligned
+            double center = (i + 0.5) / scale - 0.5;
+            double radius = support / filterScale;
+            int lo = int(std::floor(center - radius));
+            int hi = int(std::ceil(center + radius));
+            first = std::clamp(lo, 0, srcSize - 1);
+            last = std::clamp(hi, 0, srcSize - 1);
+            row.assign(last - first + 1, 0.0);
+
+            for (int j = lo; j <= hi; ++j) {
+                double x = (j - center) * filterScale;
+                double weight = 0.0;
+                switch (filter) {
+                case Filter::CatmullRom: weight = cubicKernel(x, 0.0, 0.5); break;
+                case Filter::Mitchell:   weight = cubicKernel(x, 1.0 / 3.0, 1.0 / 3.0); break;
+                case Filter::Lanczos3:   weight = lanczosKernel(x, 3); break;
+                case Filter::Area:       break;
+                }
+
+                // Taps outside the image land on the border pixel
+                row[std::clamp(j, first, last) - first] += weight;
+            }
+        }
+
+        firsts[i] = first;
+        taps = std::max(taps, int(row.size()));
+    }
+
+    // The vectorized filter takes taps in pairs
+    if (taps % 2 != 0 && taps < srcSize) {
+        ++taps;
+    }
+
+    FilterBank bank;
+    bank.taps = taps;
+    bank.start.resize(dstSize);
+    bank.weights.assign(size_t(dstSize) * taps, 0);
+
+    for (int i = 0; i < dstSize; ++i) {
+        const std::vector<double>& row = rows[i];
+        // Keep the window inside the image, the weights shift along with it
+        int start = std::clamp(firsts[i], 0, std::max(srcSize - taps, 0));
+        int16_t* weights = bank.weights.data() + size_t(i) * taps + (firsts[i] - start);
+
+        double sum = 0.0;
+        for (double weight : row) sum += weight;
+
+        // Normalize into fixed-point, the rounding error goes into the largest tap so flat areas stay flat
+        int fixedSum = 0;
+        int largest = 0;
+        for (size_t t = 0; t < row.size(); ++t) {
+            weights[t] = int16_t(std::lround(row[t] / sum * FILTER_ONE));
+            fixedSum += weights[t];
+            if (row[t] > row[largest]) largest = int(t);
+        }
+        weights[largest] += FILTER_ONE - fixedSum;
+
+        bank.start[i] = start;
+    }
+
+    return bank;
+}
+
+#if defined(SCALER_SSE2) || defined(SCALER_AVX2)
+// Weighted sum of an even number of consecutive pixels, all four channels in one register.
+// Pixels are loaded in pairs and interleaved per channel for a multiply-add with two weights.
+inline __m128i filterPixels(const QRgb* pixels, const int16_t* weights, int taps) {
+    __m128i sum = _mm_set1_epi32(FILTER_ONE / 2);
+
+    for (int t = 0; t < taps; t += 2) {
+        __m128i pair = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels + t));
+        pair = _mm_unpacklo_epi8(pair, _mm_setzero_si128());
+        pair = _mm_unpacklo_epi16(pair, _mm_srli_si128(pair, 8));
+
+        int32_t weightPair;
+        std::memcpy(&weightPair, weights + t, sizeof(weightPair));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(pair, _mm_set1_epi32(weightPair)));
+    }
+
+    return sum;
+}
+#endif
+
+// Resample every row of src with the bank, writing row y into column y of dst
+void resampleRowsTransposed(const QImage& src, QImage& dst, const FilterBank& bank) {
+    int h = src.height();
+    int dstCount = int(bank.start.size());
+    int taps = bank.taps;
+
+    uchar* dstBits = dst.bits();
+    qsizetype dstStride = dst.bytesPerLine();
 
-    int newWidth  = std::roundf(src.width() * scale);
-    int newHeight = std::roundf(src.height() * scale);
+    // Filter one destination pixel of a source row
+    auto filterPixel = [&](const QRgb* row, int x, uchar* out) {
+        const QRgb* pixels = row + bank.start[x];
+        const int16_t* weights = bank.weights.data() + size_t(x) * taps;
 
-    QImage result(newWidth, newHeight, src.format());
+#if defined(SCALER_SSE2) || defined(SCALER_AVX2)
+        if (taps % 2 == 0) {
+            // Saturating packs clamp to [0; 255]
+            __m128i sum = _mm_srai_epi32(filterPixels(pixels, weights, taps), FILTER_BITS);
+            sum = _mm_packus_epi16(_mm_packs_epi32(sum, sum), sum);
+            int32_t pixel = _mm_cvtsi128_si32(sum);
+            std::memcpy(out, &pixel, sizeof(pixel));
+            return;
+        }
+#endif
+
+        const uchar* bytes = reinterpret_cast<const uchar*>(pixels);
+        int32_t sum[4] = { FILTER_ONE / 2, FILTER_ONE / 2, FILTER_ONE / 2, FILTER_ONE / 2 };
+
+        for (int t = 0; t < taps; ++t) {
+            for (int c = 0; c < 4; ++c) {
+                sum[c] += bytes[4 * t + c] * weights[t];
+            }
+        }
+
+        for (int c = 0; c < 4; ++c) {
+            out[c] = uchar(std::clamp(sum[c] >> FILTER_BITS, 0, 255));
+        }
+    };
+
+    // Several source rows are filtered together, so their results land next to each other
+    // in a destination row instead of each pixel going to a different cache line
+    constexpr int ROWS_PER_STEP = 4;
+
+    RowBands::run(h, src.bytesPerLine(), 0, [&](int yBegin, int yEnd) {
+        for (int y = yBegin; y < yEnd; y += ROWS_PER_STEP) {
+            int rowCount = std::min(ROWS_PER_STEP, yEnd - y);
+            const QRgb* rows[ROWS_PER_STEP];
+            for (int i = 0; i < rowCount; ++i) {
+                rows[i] = reinterpret_cast<const QRgb*>(src.constScanLine(y + i));
+            }
+
+            uchar* column = dstBits + qsizetype(y) * sizeof(QRgb);
+
+            for (int x = 0; x < dstCount; ++x) {
+                uchar* out = column + x * dstStride;
+
+                for (int i = 0; i < rowCount; ++i) {
+                    filterPixel(rows[i], x, out + i * sizeof(QRgb));
+                }
+            }
+        }
+    });
+}
+
+// Average 2x2 blocks of two source rows into count destination pixels, rounding to nearest.
+// Rows are at least 2 * count pixels long.
+void halveRows(const QRgb* top, const QRgb* bottom, int count, QRgb* dst) {
+    int x = 0;
+
+#if defined(SCALER_SSE2) || defined(SCALER_AVX2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi16(2);
+
+    // Two destination pixels from four source pixels of each row
+    for (; x + 2 <= count; x += 2) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + 2 * x));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + 2 * x));
+
+        // Vertical sums of pixels 0, 1 and 2, 3 as 16-bit channels
+        __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+        // Even pixels plus odd pixels
+        __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+        sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(sum, sum));
+    }
+#endif
+
+    for (; x < count; ++x) {
+        const uchar* a = reinterpret_cast<const uchar*>(top + 2 * x);
+        const uchar* b = reinterpret_cast<const uchar*>(bottom + 2 * x);
+        uchar* out = reinterpret_cast<uchar*>(dst + x);
+
+        for (int c = 0; c < 4; ++c) {
+            out[c] = uchar((a[c] + a[c + 4] + b[c] + b[c + 4] + 2) >> 2);
+        }
+    }
+}
+
+// Source rows a band of a scaled image is computed from: rows [top; top + image.height())
+// of a source that is height rows high. Ordinary scaling passes the whole source.
+struct SourceStrip {
+    const QImage& image;
+    int top;
+    int height;
 
-    float xRatio = static_cast<float>(src.width()) / newWidth;
-    float yRatio = static_cast<float>(src.height()) / newHeight;
+    const QRgb* row(int index) const {
+        return reinterpret_cast<const QRgb*>(image.constScanLine(index - top));
+    }
+};
+
+// Fill result with rows [firstRow; firstRow + result.height()) of the source scaled to
+// result.width() x newHeight with the nearest neighbour
+void nearestNeighbourRows(const SourceStrip& source, int newHeight, int firstRow, QImage& result,
+                          ImageProcessor::ScalingPath path) {
+    int width = source.image.width();
+    int newWidth = result.width();
+
+    uchar* resultBits = result.bits();
+    qsizetype resultStride = result.bytesPerLine();
+
+    if (path == ImageProcessor::ScalingPath::Reference) {
+        float xRatio = static_cast<float>(width) / newWidth;
+        float yRatio = static_cast<float>(source.height) / newHeight;
 
-    for (int y = 0; y < newHeight; ++y) {
-        QRgb *resultRow = reinterpret_cast<QRgb*>(result.scanLine(y));
-        int srcY = static_cast<int>(y * yRatio);
-        const QRgb *srcRow = reinterpret_cast<const QRgb*>(src.scanLine(srcY));
+        RowBands::run(result.height(), resultStride, 0, [&](int yBegin, int yEnd) {
+            for (int y = yBegin; y < yEnd; ++y) {
+                QRgb *resultRow = reinterpret_cast<QRgb*>(resultBits + y * resultStride);
+                int srcY = std::min(static_cast<int>((firstRow + y) * yRatio), source.height - 1);
+                const QRgb *srcRow = source.row(srcY);
+
+                for (int x = 0; x < newWidth; ++x) {
+                    int srcX = std::min(static_cast<int>(x * xRatio), width - 1);
+                    resultRow[x] = srcRow[srcX];
+                }
+            }
+        });
+
+        return;
+    }
 
-        for (int x = 0; x < newWidth; ++x) {
-            int srcX = static_cast<int>(x * xRatio);
-            resultRow[x] = srcRow[srcX];
+    std::vector<int> columns = nearestTaps(width, newWidth, 0, newWidth);
+    std::vector<int> rows = nearestTaps(source.height, newHeight, firstRow, firstRow + result.height());
+
+    RowBands::run(result.height(), resultStride, 0, [&](int yBegin, int yEnd) {
+        for (int y = yBegin; y < yEnd; ++y) {
+            QRgb *resultRow = reinterpret_cast<QRgb*>(resultBits + y * resultStride);
+
+            // When upscaling, neighbouring rows often come from the same source row
+            if (y > yBegin && rows[y] == rows[y - 1]) {
+                std::memcpy(resultRow, resultBits + (y - 1) * resultStride, size_t(newWidth) * sizeof(QRgb));
+                continue;
+            }
+
+            const QRgb *srcRow = source.row(rows[y]);
+            int x = 0;
+
+#if defined(SCALER_AVX2)
+            for (; x + 8 <= newWidth; x += 8) {
+                __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(columns.data() + x));
+                __m256i pixels = _mm256_i32gather_epi32(reinterpret_cast<const int*>(srcRow), index, 4);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(resultRow + x), pixels);
+            }
+#endif
+
+            for (; x < newWidth; ++x) {
+                resultRow[x] = srcRow[columns[x]];
+            }
         }
+    });
+}
+
+// Fill result with rows [firstRow; firstRow + result.height()) of the source scaled to
+// result.width() x newHeight with bilinear interpolation
+void bilinearRows(const SourceStrip& source, int newHeight, int firstRow, QImage& result,
+                  ImageProcessor::ScalingPath path) {
+    int width = source.image.width();
+    int height = source.height;
+    int newWidth = result.width();
+
+    uchar* resultBits = result.bits();
+    qsizetype resultStride = result.bytesPerLine();
+
+    std::vector<Tap> columns = bilinearTaps(width, newWidth, 0, newWidth);
+    std::vector<Tap> rows = bilinearTaps(height, newHeight, firstRow, firstRow + result.height());
+
+    // The vectorized row interpolation reads two neighbouring pixels at once
+    if (path == ImageProcessor::ScalingPath::Reference || width < 2) {
+        RowBands::run(result.height(), resultStride, 1, [&](int yBegin, int yEnd) {
+            for (int y = yBegin; y < yEnd; ++y) {
+                const Tap& row = rows[y];
+                const QRgb *row1 = source.row(row.index);
+                const QRgb *row2 = source.row(std::min(row.index + 1, height - 1));
+                uchar* resultRow = resultBits + y * resultStride;
+
+                for (int x = 0; x < newWidth; ++x) {
+                    const Tap& column = columns[x];
+                    int x2 = std::min(column.index + 1, width - 1);
+
+                    // Get 4 neighbors
+                    const uchar* p1 = reinterpret_cast<const uchar*>(row1 + column.index); // Top-Left
+                    const uchar* p2 = reinterpret_cast<const uchar*>(row1 + x2);           // Top-Right
+                    const uchar* p3 = reinterpret_cast<const uchar*>(row2 + column.index); // Bottom-Left
+                    const uchar* p4 = reinterpret_cast<const uchar*>(row2 + x2);           // Bottom-Right
+
+                    // Every channel, alpha included
+                    for (int c = 0; c < 4; ++c) {
+                        int top = p1[c] * (WEIGHT_ONE - column.weight) + p2[c] * column.weight;
+                        int bottom = p3[c] * (WEIGHT_ONE - column.weight) + p4[c] * column.weight;
+                        resultRow[4 * x + c] = uchar(blendChannel(top, bottom, row.weight));
+                    }
+                }
+            }
+        });
+
+        return;
     }
 
+    RowBands::run(result.height(), resultStride * 4, 1, [&](int yBegin, int yEnd) {
+        // Source rows interpolated at every destination column, reused while the
+        // destination rows keep falling between the same pair of source rows
+        std::vector<int32_t> buffer(size_t(newWidth) * 4 * 2);
+        int32_t* top = buffer.data();
+        int32_t* bottom = top + size_t(newWidth) * 4;
+        int topRow = -1;
+        int bottomRow = -1;
+
+        for (int y = yBegin; y < yEnd; ++y) {
+            int row1 = rows[y].index;
+            int row2 = std::min(row1 + 1, height - 1);
+
+            // Moving one source row down turns the bottom row into the top one
+            if (row1 == bottomRow && row1 != topRow) {
+                std::swap(top, bottom);
+                std::swap(topRow, bottomRow);
+            }
+            if (row1 != topRow) {
+                interpolateRow(source.row(row1), columns.data(), newWidth, top);
+                topRow = row1;
+            }
+            if (row2 != bottomRow) {
+                interpolateRow(source.row(row2), columns.data(), newWidth, bottom);
+                bottomRow = row2;
+            }
+
+            blendRows(top, bottom, rows[y].weight, newWidth, reinterpret_cast<QRgb*>(resultBits + y * resultStride));
+        }
+    });
+}
+
+} // namespace
+
+QSize ImageProcessor::scaledSize(const QImage& src, float scale) {
+    return QSize(std::roundf(src.width() * scale), std::roundf(src.height() * scale));
+}
+
+QImage ImageProcessor::applyNearestNeighbourScaling(const QImage& src, float scale, ScalingPath path) {
+    return applyNearestNeighbourScaling(src, scaledSize(src, scale), path);
+}
+
+QImage ImageProcessor::applyBilinearScaling(const QImage& src, float scale, ScalingPath path) {
+    return applyBilinearScaling(src, scaledSize(src, scale), path);
+}
+
+QImage ImageProcessor::applyResampling(const QImage& src, float scale, ResamplingFilter filter) {
+    return applyResampling(src, scaledSize(src, scale), filter);
+}
+
+QImage ImageProcessor::applyNearestNeighbourScaling(const QImage& src, const QSize& size, ScalingPath path) {
+    if (src.isNull()) return QImage();
+    if (size.width() <= 0 || size.height() <= 0) return QImage();
+
+    QImage source = src.depth() == 32 ? src : src.convertToFormat(QImage::Format_ARGB32);
+    QImage result(size, source.format());
+
+    nearestNeighbourRows({ source, 0, source.height() }, size.height(), 0, result, path);
+
     return result;
 }
 
-QImage ImageProcessor::applyBilinearScaling(const QImage &src, float scale) {
+QImage ImageProcessor::applyBilinearScaling(const QImage& src, const QSize& size, ScalingPath path) {
     if (src.isNull()) return QImage();
+    if (size.width() <= 0 || size.height() <= 0) return QImage();
 
-    int newWidth = std::roundf(src.width() * scale);
-    int newHeight = std::roundf(src.height() * scale);
-
-    QImage result(newWidth, newHeight, src.format());
-
-    float xRatio = static_cast<float>(src.width() - 1) / (newWidth > 1 ? newWidth - 1 : 1);
-    float yRatio = static_cast<float>(src.height() - 1) / (newHeight > 1 ? newHeight - 1 : 1);
-
-    for (int y = 0; y < newHeight; ++y) {
-        // Source Y coordinates
-        float srcY = y * yRatio;
-        int y1 = static_cast<int>(srcY);
-        int y2 = (y1 < src.height() - 1) ? y1 + 1 : y1;
-        float dy = srcY - y1;
-        float one_minus_dy = 1.0f - dy;
-
-        const QRgb *row1 = reinterpret_cast<const QRgb*>(src.scanLine(y1));
-        const QRgb *row2 = reinterpret_cast<const QRgb*>(src.scanLine(y2));
-        QRgb* resultRow = reinterpret_cast<QRgb*>(result.scanLine(y));
-
-        for (int x = 0; x < newWidth; ++x) {
-            // Source X coordinates
-            float srcX = x * xRatio;
-            int x1 = static_cast<int>(srcX);
-            int x2 = (x1 < src.width() - 1) ? x1 + 1 : x1;
-            float dx = srcX - x1;
-            float one_minus_dx = 1.0f - dx;
-
-            // Get 4 neighbors
-            QRgb p1 = row1[x1]; // Top-Left
-            QRgb p2 = row1[x2]; // Top-Right
-            QRgb p3 = row2[x1]; // Bottom-Left
-            QRgb p4 = row2[x2]; // Bottom-Right
-
-            // Red
-            int r = (qRed(p1) * one_minus_dx * one_minus_dy) +
-                    (qRed(p2) * dx * one_minus_dy) +
-                    (qRed(p3) * one_minus_dx * dy) +
-                    (qRed(p4) * dx * dy);
-
-            // Green
-            int g = (qGreen(p1) * one_minus_dx * one_minus_dy) +
-                    (qGreen(p2) * dx * one_minus_dy) +
-                    (qGreen(p3) * one_minus_dx * dy) +
-                    (qGreen(p4) * dx * dy);
-
-            // Blue
-            int b = (qBlue(p1) * one_minus_dx * one_minus_dy) +
-                    (qBlue(p2) * dx * one_minus_dy) +
-                    (qBlue(p3) * one_minus_dx * dy) +
-                    (qBlue(p4) * dx * dy);
-
-            // Alpha
-            int a = (qAlpha(p1) * one_minus_dx * one_minus_dy) +
-                    (qAlpha(p2) * dx * one_minus_dy) +
-                    (qAlpha(p3) * one_minus_dx * dy) +
-                    (qAlpha(p4) * dx * dy);
-
-            resultRow[x] = qRgba(r, g, b, a);
-        }
+    QImage source = src.depth() == 32 ? src : src.convertToFormat(QImage::Format_ARGB32);
+    QImage result(size, source.format());
+
+    bilinearRows({ source, 0, source.height() }, size.height(), 0, result, path);
+
+    return result;
+}
+
+QPair<int, int> ImageProcessor::bandSourceRows(ScalingMethod method, int sourceHeight, int newHeight, int yBegin, int yEnd) {
+    // Both tap functions are monotonic, so the first and the last row of the band bound the range
+    if (method == ScalingMethod::NearestNeighbour) {
+        return { nearestTap(yBegin, sourceHeight, newHeight), nearestTap(yEnd - 1, sourceHeight, newHeight) + 1 };
+    }
+
+    return { bilinearTap(yBegin, sourceHeight, newHeight).index,
+             std::min(bilinearTap(yEnd - 1, sourceHeight, newHeight).index + 2, sourceHeight) };
+}
+
+QImage ImageProcessor::applyBandScaling(ScalingMethod method, const QImage& strip, int stripTop, int sourceHeight,
+                                        const QSize& size, int yBegin, int yEnd) {
+    if (strip.isNull()) return QImage();
+    if (size.width() <= 0 || yEnd <= yBegin) return QImage();
+
+    QImage source = strip.depth() == 32 ? strip : strip.convertToFormat(QImage::Format_ARGB32);
+    QImage result(size.width(), yEnd - yBegin, source.format());
+
+    if (method == ScalingMethod::NearestNeighbour) {
+        nearestNeighbourRows({ source, stripTop, sourceHeight }, size.height(), yBegin, result, ScalingPath::Simd);
+    } else {
+        bilinearRows({ source, stripTop, sourceHeight }, size.height(), yBegin, result, ScalingPath::Simd);
     }
 
     return result;
 }
 
+QImage ImageProcessor::applyResampling(const QImage& src, const QSize& size, ResamplingFilter filter) {
+    if (src.isNull()) return QImage();
+
+    int newWidth = size.width();
+    int newHeight = size.height();
+    if (newWidth <= 0 || newHeight <= 0) return QImage();
+
+    QImage source = src.depth() == 32 ? src : src.convertToFormat(QImage::Format_ARGB32);
+
+    FilterBank columns = filterBank(source.width(), newWidth, filter);
+    FilterBank rows = filterBank(source.height(), newHeight, filter);
+
+    // Horizontal pass writes columns, so the vertical pass reads rows as well
+    QImage transposed(source.height(), newWidth, source.format());
+    QImage result(newWidth, newHeight, source.format());
+
+    resampleRowsTransposed(source, transposed, columns);
+    resampleRowsTransposed(transposed, result, rows);
+
+    return result;
+}
+
+QImage ImageProcessor::reduceByHalf(const QImage& src) {
+    if (src.isNull()) return QImage();
+
+    QImage source = src.depth() == 32 ? src : src.convertToFormat(QImage::Format_ARGB32);
+
+    int width = source.width();
+    int height = source.height();
+    int newWidth = std::max(width / 2, 1);
+    int newHeight = std::max(height / 2, 1);
+
+    QImage result(newWidth, newHeight, source.format());
+
+    uchar* resultBits = result.bits();
+    qsizetype resultStride = result.bytesPerLine();
+
+    RowBands::run(newHeight, source.bytesPerLine() * 2, 0, [&](int yBegin, int yEnd) {
+        // A one pixel wide source is averaged with itself
+        std::vector<QRgb> padded(width == 1 ? 2 : 0);
+        std::vector<QRgb> paddedBottom(padded.size());
+
+        for (int y = yBegin; y < yEnd; ++y) {
+            const QRgb* top = reinterpret_cast<const QRgb*>(source.constScanLine(std::min(2 * y, height - 1)));
+            const QRgb* bottom = reinterpret_cast<const QRgb*>(source.constScanLine(std::min(2 * y + 1, height - 1)));
+
+            if (width == 1) {
+                padded[0] = padded[1] = top[0];
+                paddedBottom[0] = paddedBottom[1] = bottom[0];
+                top = padded.data();
+                bottom = paddedBottom.data();
+            }
+
+            halveRows(top, bottom, newWidth, reinterpret_cast<QRgb*>(resultBits + y * resultStride));
+        }
+    });
+
+    return result;
+}
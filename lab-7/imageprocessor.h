@@ -3,14 +3,54 @@
 
 #include <QObject>
 #include <QImage>
+#include <QPair>
 
 class ImageProcessor : public QObject
 {
     Q_OBJECT
 
 public:
-    static QImage applyNearestNeighbourScaling(const QImage& src, float scale);
-    static QImage applyBilinearScaling(const QImage& src, float scale);
+    // Which implementation of a scaler runs
+    enum class ScalingPath {
+        Simd,     // Precomputed column and row tables, SSE2/AVX2 kernels where available
+        Reference // Plain per-pixel loops, bit-exact with the Simd path
+    };
+
+    // Interpolation of the band scaler
+    enum class ScalingMethod {
+        NearestNeighbour,
+        Bilinear
+    };
+
+    // Reconstruction filter of the separable resampler
+    enum class ResamplingFilter {
+        Area,       // Average of the source pixels covered by a destination pixel
+        CatmullRom, // Bicubic with B = 0, C = 1/2: sharp, slight halos
+        Mitchell,   // Bicubic with B = C = 1/3: softer, fewer halos
+        Lanczos3    // Sinc windowed to 3 lobes: sharpest, rings on hard edges
+    };
+
+    // Size of src scaled by the factor, rounded to whole pixels
+    static QSize scaledSize(const QImage& src, float scale);
+
+    static QImage applyNearestNeighbourScaling(const QImage& src, float scale, ScalingPath path = ScalingPath::Simd);
+    static QImage applyNearestNeighbourScaling(const QImage& src, const QSize& size, ScalingPath path = ScalingPath::Simd);
+    static QImage applyBilinearScaling(const QImage& src, float scale, ScalingPath path = ScalingPath::Simd);
+    static QImage applyBilinearScaling(const QImage& src, const QSize& size, ScalingPath path = ScalingPath::Simd);
+    // Two-pass (horizontal, then vertical) resampling whose filter widens when downscaling
+    static QImage applyResampling(const QImage& src, float scale, ResamplingFilter filter);
+    static QImage applyResampling(const QImage& src, const QSize& size, ResamplingFilter filter);
+
+    // Source rows [first; last) that rows [yBegin; yEnd) of a sourceHeight high image scaled to newHeight read
+    static QPair<int, int> bandSourceRows(ScalingMethod method, int sourceHeight, int newHeight, int yBegin, int yEnd);
+    // Rows [yBegin; yEnd) of a sourceHeight high image scaled to size, with strip holding (at least) the
+    // source rows that bandSourceRows() names, starting from source row stripTop. Same pixels as the
+    // whole-image scalers, for images too large to hold in memory at once
+    static QImage applyBandScaling(ScalingMethod method, const QImage& strip, int stripTop, int sourceHeight,
+                                   const QSize& size, int yBegin, int yEnd);
+
+    // Halve both dimensions (rounding down, at least 1 pixel) by averaging 2x2 blocks
+    static QImage reduceByHalf(const QImage& src);
 };
 
 #endif // IMAGEPROCESSOR_H
@@ -0,0 +1,48 @@
+#include "imagepyramid.h"
+#include "imageprocessor.h"
+
+ImagePyramid::ImagePyramid(qsizetype byteBudget)
+    : m_budget(byteBudget)
+    , m_cachedBytes(0)
+{
+}
+
+void ImagePyramid::setSource(const QImage& image) {
+    clear();
+    if (!image.isNull()) m_levels.append(image);
+}
+
+void ImagePyramid::clear() {
+    m_levels.clear();
+    m_cachedBytes = 0;
+}
+
+QImage ImagePyramid::levelFor(const QSize& target) {
+    if (m_levels.isEmpty()) return QImage();
+
+    // Halving again must not drop below the target in either dimension
+    auto fits = [&](const QImage& level) {
+        return level.width() / 2 >= target.width() && level.height() / 2 >= target.height()
+               && level.width() > 1 && level.height() > 1;
+    };
+
+    int index = 0;
+    while (index + 1 < m_levels.size() && fits(m_levels[index])) ++index;
+
+    QImage level = m_levels[index];
+    if (index + 1 < m_levels.size() || !fits(level)) return level;
+
+    // Build the missing levels; those past the budget are used once and not kept
+    while (fits(level)) {
+        level = ImageProcessor::reduceByHalf(level);
+
+        qsizetype bytes = level.sizeInBytes();
+        if (index + 1 == m_levels.size() && m_cachedBytes + bytes <= m_budget) {
+            m_levels.append(level);
+            m_cachedBytes += bytes;
+        }
+        ++index;
+    }
+
+    return level;
+}
@@ -0,0 +1,37 @@
+#ifndef IMAGEPYRAMID_H
+#define IMAGEPYRAMID_H
+
+#include <QImage>
+#include <QList>
+#include <QSize>
+
+// Chain of 2x reductions of a source image, built lazily on first use.
+// Downscaling from the smallest level that is still at least as large as the target
+// costs a fraction of resampling the full source and keeps the filters narrow.
+class ImagePyramid
+{
+public:
+    static constexpr qsizetype DEFAULT_BUDGET = 128 * 1024 * 1024; // Bytes of cached levels
+
+    explicit ImagePyramid(qsizetype byteBudget = DEFAULT_BUDGET);
+
+    // Drop all cached levels and start over from the image (level 0)
+    void setSource(const QImage& image);
+    void clear();
+
+    const QImage& source() const { return m_levels.isEmpty() ? m_empty : m_levels.first(); }
+
+    // Smallest level whose both dimensions are at least those of the target size
+    QImage levelFor(const QSize& target);
+
+    // Bytes held by the cached reductions, the source itself not included
+    qsizetype cachedBytes() const { return m_cachedBytes; }
+
+private:
+    QList<QImage> m_levels; // m_levels[i] is the source halved i times
+    qsizetype m_budget;
+    qsizetype m_cachedBytes;
+    QImage m_empty;
+};
+
+#endif // IMAGEPYRAMID_H
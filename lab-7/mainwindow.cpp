@@ -2,6 +2,12 @@
 #include "./ui_mainwindow.h"
 
 #include "imageprocessor.h"
+#include "streamingscaler.h"
+
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QProgressDialog>
+#include <QThreadPool>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -96,7 +102,9 @@ void MainWindow::setupUI() {
     m_scalingValueInput->setText("1.0");
 
     m_interpolationMethod = new QComboBox();
-    m_interpolationMethod->addItems({"Метод ближайшего соседа", "Билинейная интерполяция"});
+    m_interpolationMethod->addItems({"Метод ближайшего соседа", "Билинейная интерполяция",
+                                     "Усреднение по площади", "Бикубическая (Catmull-Rom)",
+                                     "Бикубическая (Mitchell)", "Фильтр Ланцоша (3 лепестка)"});
 
     QPushButton *applyScalingButton = new QPushButton("Применить масштабирование");
     connect(applyScalingButton, &QPushButton::clicked, this, [this](){
@@ -121,6 +129,22 @@ void MainWindow::setupUI() {
     scalingLayout->addWidget(applyScalingButton);
     rightLayout->addWidget(scalingGroup);
 
+    // Scaling of files that don't fit into memory
+    QGroupBox *fileScalingGroup = new QGroupBox("Масштабирование файла");
+    QVBoxLayout *fileScalingLayout = new QVBoxLayout(fileScalingGroup);
+
+    m_stripHeightInput = new QSpinBox();
+    m_stripHeightInput->setRange(1, 4096);
+    m_stripHeightInput->setValue(256);
+
+    QPushButton *scaleFileButton = new QPushButton("Масштабировать файл...");
+    connect(scaleFileButton, &QPushButton::clicked, this, &MainWindow::scaleFile);
+
+    fileScalingLayout->addWidget(new QLabel("Строк в полосе:"));
+    fileScalingLayout->addWidget(m_stripHeightInput);
+    fileScalingLayout->addWidget(scaleFileButton);
+    rightLayout->addWidget(fileScalingGroup);
+
     rightLayout->addStretch(); // Push widgets to top
     splitter->setStretchFactor(0, 1); // Image takes available space
     splitter->setStretchFactor(1, 0); // Controls take minimum space
@@ -140,6 +164,7 @@ void MainWindow::loadImage() {
 
     m_originalImage = m_originalImage.convertToFormat(QImage::Format_ARGB32);
     m_processedImage = m_originalImage;
+    m_pyramid.setSource(m_originalImage);
 
     m_scene->clear();
     m_imageItem = nullptr;
@@ -174,25 +199,92 @@ void MainWindow::resetImage() {
 
 void MainWindow::scaleImage() {
     int method = m_interpolationMethod->currentIndex();
+    QSize size = ImageProcessor::scaledSize(m_originalImage, m_scale);
 
-    if (method == 0) { // Nearest neighbour
-        m_processedImage = ImageProcessor::applyNearestNeighbourScaling(m_originalImage, m_scale);
-    } else { // Bilinear interpolation
-        m_processedImage = ImageProcessor::applyBilinearScaling(m_originalImage, m_scale);
+    if (method == 0) { // Nearest neighbour picks source pixels, so it always reads the original
+        m_processedImage = ImageProcessor::applyNearestNeighbourScaling(m_originalImage, size);
+    } else {
+        // Filtering methods start from the smallest cached reduction that is still large enough
+        QImage source = m_pyramid.levelFor(size);
+
+        if (method == 1) { // Bilinear interpolation
+            m_processedImage = ImageProcessor::applyBilinearScaling(source, size);
+        } else { // Separable resampling, filters follow the combo box order
+            using Filter = ImageProcessor::ResamplingFilter;
+            const Filter filters[] = { Filter::Area, Filter::CatmullRom, Filter::Mitchell, Filter::Lanczos3 };
+            m_processedImage = ImageProcessor::applyResampling(source, size, filters[method - 2]);
+        }
     }
 
     updateImage();
 }
 
+void MainWindow::scaleFile() {
+    int method = m_interpolationMethod->currentIndex();
+    if (method > 1) {
+        QMessageBox::warning(this, "Ошибка", "Файл можно масштабировать методом ближайшего соседа или билинейной интерполяцией.");
+        return;
+    }
 
+    bool ok;
+    float scale = m_scalingValueInput->text().toFloat(&ok);
+    if (!ok || scale <= 0.0f) {
+        QMessageBox::warning(this, "Ошибка", "Некорректное значение, введите число больше 0.");
+        return;
+    }
 
+    QString sourcePath = QFileDialog::getOpenFileName(
+        this, "Исходное изображение", "", "Изображения (*.png *.jpg *.jpeg *.bmp *.tif *.tiff)"
+        );
+    if (sourcePath.isEmpty()) return;
 
+    QString targetPath = QFileDialog::getSaveFileName(
+        this, "Сохранить результат", "", "PNG (*.png);;TIFF (*.tif *.tiff);;Без заголовка, ARGB32 (*.raw)"
+        );
+    if (targetPath.isEmpty()) return;
+
+    StreamingScaler::Options options;
+    options.scale = scale;
+    options.method = method == 0 ? ImageProcessor::ScalingMethod::NearestNeighbour : ImageProcessor::ScalingMethod::Bilinear;
+    options.format = StreamingScaler::formatForFile(targetPath);
+    options.stripHeight = m_stripHeightInput->value();
+
+    // Large files take a while, so the scaler runs on a pool thread and reports every band
+    QProgressDialog *progress = new QProgressDialog("Масштабирование файла...", "Отменить", 0, 0, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(0);
+
+    QFutureWatcher<QString> *watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcherBase::progressRangeChanged, progress, &QProgressDialog::setRange);
+    connect(watcher, &QFutureWatcherBase::progressValueChanged, progress, &QProgressDialog::setValue);
+    connect(progress, &QProgressDialog::canceled, watcher, &QFutureWatcherBase::cancel);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, progress]() {
+        progress->deleteLater();
+        watcher->deleteLater();
+
+        // A failed run leaves its error as the only result, a cancelled one leaves none
+        if (!watcher->isCanceled() && watcher->future().resultCount() > 0) {
+            QMessageBox::critical(this, "Ошибка", watcher->future().result());
+        }
+    });
 
-
-
-
-
-
-
-
-
+    // Reported through QFutureInterface rather than QPromise, which only exists in Qt 6
+    QFutureInterface<QString> task;
+    task.reportStarted();
+    watcher->setFuture(task.future());
+
+    QThreadPool::globalInstance()->start([task, sourcePath, targetPath, options]() mutable {
+        StreamingScaler::Options reported = options;
+        reported.progress = [&task](int rowsDone, int rowsTotal) {
+            task.setProgressRange(0, rowsTotal);
+            task.setProgressValue(rowsDone);
+            return !task.isCanceled();
+        };
+
+        QString error;
+        if (!StreamingScaler::scaleFile(sourcePath, targetPath, reported, &error)) {
+            task.reportResult(error);
+        }
+        task.reportFinished();
+    });
+}
@@ -16,6 +16,9 @@
 #include <QMessageBox>
 #include <QLineEdit>
 #include <QComboBox>
+#include <QSpinBox>
+
+#include "imagepyramid.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -37,6 +40,7 @@ private:
     void resetImage();
     void loadImage();
     void scaleImage();
+    void scaleFile();
 
 private:
     Ui::MainWindow *ui;
@@ -46,9 +50,11 @@ private:
     QGraphicsPixmapItem *m_imageItem;
     QImage m_originalImage;
     QImage m_processedImage;
+    ImagePyramid m_pyramid; // Reductions of m_originalImage that downscaling starts from
 
     float m_scale;
     QComboBox *m_interpolationMethod;
     QLineEdit *m_scalingValueInput;
+    QSpinBox *m_stripHeightInput; // Rows per band of the file scaler
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,412 @@
+#include "streamingscaler.h"
+
+#include <QFileInfo>
+#include <QImageReader>
+#include <QRect>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace {
+
+void appendBigEndian32(QByteArray& data, uint32_t value) {
+    data.append(char(value >> 24));
+    data.append(char(value >> 16));
+    data.append(char(value >> 8));
+    data.append(char(value));
+}
+
+void appendLittleEndian16(QByteArray& data, uint16_t value) {
+    data.append(char(value));
+    data.append(char(value >> 8));
+}
+
+void appendLittleEndian32(QByteArray& data, uint32_t value) {
+    appendLittleEndian16(data, uint16_t(value));
+    appendLittleEndian16(data, uint16_t(value >> 16));
+}
+
+// Pixels of a Format_ARGB32 row as R, G, B, A bytes
+void appendRgba(QByteArray& data, const QRgb* row, int width) {
+    qsizetype offset = data.size();
+    data.resize(offset + qsizetype(width) * 4);
+    uchar* out = reinterpret_cast<uchar*>(data.data()) + offset;
+
+    for (int x = 0; x < width; ++x) {
+        out[4 * x + 0] = uchar(qRed(row[x]));
+        out[4 * x + 1] = uchar(qGreen(row[x]));
+        out[4 * x + 2] = uchar(qBlue(row[x]));
+        out[4 * x + 3] = uchar(qAlpha(row[x]));
+    }
+}
+
+// Appends the bands of an image, top to bottom, to a file
+class BandWriter
+{
+public:
+    explicit BandWriter(QIODevice& device) : m_device(device) {}
+    virtual ~BandWriter() = default;
+
+    virtual bool begin(const QSize& size, int stripHeight) = 0;
+    // Band of Format_ARGB32 rows, every band but the last one stripHeight rows high
+    virtual bool writeBand(const QImage& band) = 0;
+    virtual bool finish() = 0;
+
+    // Why the last call failed
+    QString errorString() const { return m_error.isEmpty() ? m_device.errorString() : m_error; }
+
+protected:
+    bool write(const QByteArray& data) { return m_device.write(data) == data.size(); }
+
+    QIODevice& m_device;
+    QString m_error; // Failures of the format itself rather than of the device
+};
+
+class RawWriter : public BandWriter
+{
+public:
+    using BandWriter::BandWriter;
+
+    bool begin(const QSize&, int) override { return true; }
+
+    bool writeBand(const QImage& band) override {
+        qsizetype rowBytes = qsizetype(band.width()) * sizeof(QRgb);
+
+        for (int y = 0; y < band.height(); ++y) {
+            const char* row = reinterpret_cast<const char*>(band.constScanLine(y));
+            if (m_device.write(row, rowBytes) != rowBytes) return false;
+        }
+
+        return true;
+    }
+
+    bool finish() override { return true; }
+};
+
+// Writes the zlib stream of the image data as stored (uncompressed) deflate blocks, which
+// needs no state between bands besides the running Adler-32 checksum
+class PngWriter : public BandWriter
+{
+public:
+    using BandWriter::BandWriter;
+
+    bool begin(const QSize& size, int) override {
+        static const char SIGNATURE[] = { '\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n' };
+
+        QByteArray header;
+        appendBigEndian32(header, uint32_t(size.width()));
+        appendBigEndian32(header, uint32_t(size.height()));
+        header.append(char(8)); // Bits per channel
+        header.append(char(6)); // RGBA
+        header.append(char(0)); // Deflate
+        header.append(char(0)); // Adaptive filtering
+        header.append(char(0)); // Not interlaced
+
+        m_adlerA = 1;
+        m_adlerB = 0;
+        m_started = false;
+
+        return write(QByteArray(SIGNATURE, sizeof(SIGNATURE))) && writeChunk("IHDR", header);
+    }
+
+    bool writeBand(const QImage& band) override {
+        // Every row starts with its filter type, 0 (none)
+        QByteArray rows;
+        rows.reserve(qsizetype(band.height()) * (1 + qsizetype(band.width()) * 4));
+
+        for (int y = 0; y < band.height(); ++y) {
+            rows.append(char(0));
+            appendRgba(rows, reinterpret_cast<const QRgb*>(band.constScanLine(y)), band.width());
+        }
+
+        updateAdler(rows);
+
+        QByteArray data;
+        if (!m_started) {
+            data.append(char(0x78)); // Deflate with a 32 KiB window
+            data.append(char(0x01)); // No preset dictionary, check bits
+            m_started = true;
+        }
+
+        for (qsizetype offset = 0; offset < rows.size(); offset += MAX_STORED_BLOCK) {
+            uint16_t length = uint16_t(std::min<qsizetype>(rows.size() - offset, MAX_STORED_BLOCK));
+            data.append(char(0)); // Not the final block, stored
+            appendLittleEndian16(data, length);
+            appendLittleEndian16(data, uint16_t(~length));
+            data.append(rows.constData() + offset, length);
+        }
+
+        return writeChunk("IDAT", data);
+    }
+
+    bool finish() override {
+        // Empty final block closes the deflate stream, the checksum closes the zlib one
+        QByteArray data;
+        data.append(char(1));
+        appendLittleEndian16(data, 0);
+        appendLittleEndian16(data, 0xffff);
+        appendBigEndian32(data, (m_adlerB << 16) | m_adlerA);
+
+        return writeChunk("IDAT", data) && writeChunk("IEND", QByteArray());
+    }
+
+private:
+    static constexpr qsizetype MAX_STORED_BLOCK = 65535;
+    static constexpr uint32_t ADLER_MODULUS = 65521;
+    static constexpr qsizetype ADLER_RUN = 5552; // Bytes that can be summed before b overflows
+
+    bool writeChunk(const char type[4], const QByteArray& data) {
+        QByteArray chunk;
+        appendBigEndian32(chunk, uint32_t(data.size()));
+        chunk.append(type, 4);
+        chunk.append(data);
+        appendBigEndian32(chunk, crc32(chunk.constData() + 4, chunk.size() - 4));
+
+        return write(chunk);
+    }
+
+    void updateAdler(const QByteArray& data) {
+        const uchar* bytes = reinterpret_cast<const uchar*>(data.constData());
+
+        for (qsizetype begin = 0; begin < data.size(); begin += ADLER_RUN) {
+            qsizetype end = std::min(begin + ADLER_RUN, data.size());
+            for (qsizetype i = begin; i < end; ++i) {
+                m_adlerA += bytes[i];
+                m_adlerB += m_adlerA;
+            }
+            m_adlerA %= ADLER_MODULUS;
+            m_adlerB %= ADLER_MODULUS;
+        }
+    }
+
+    static uint32_t crc32(const char* data, qsizetype size) {
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> result;
+            for (uint32_t n = 0; n < 256; ++n) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                }
+                result[n] = c;
+            }
+            return result;
+        }();
+
+        uint32_t crc = 0xffffffffu;
+        for (qsizetype i = 0; i < size; ++i) {
+            crc = table[(crc ^ uchar(data[i])) & 0xff] ^ (crc >> 8);
+        }
+
+        return crc ^ 0xffffffffu;
+    }
+
+    uint32_t m_adlerA = 1;
+    uint32_t m_adlerB = 0;
+    bool m_started = false;
+};
+
+// Strips go right after the 8-byte header as they come, the directory describing them
+// is written at the end and the header is patched to point at it
+class TiffWriter : public BandWriter
+{
+public:
+    using BandWriter::BandWriter;
+
+    bool begin(const QSize& size, int stripHeight) override {
+        m_size = size;
+        m_stripHeight = stripHeight;
+        m_offsets.clear();
+        m_counts.clear();
+
+        QByteArray header("II");
+        appendLittleEndian16(header, 42);
+        appendLittleEndian32(header, 0); // Directory offset, patched in finish()
+
+        return write(header);
+    }
+
+    bool writeBand(const QImage& band) override {
+        QByteArray strip;
+        strip.reserve(qsizetype(band.height()) * band.width() * 4);
+
+        for (int y = 0; y < band.height(); ++y) {
+            appendRgba(strip, reinterpret_cast<const QRgb*>(band.constScanLine(y)), band.width());
+        }
+
+        // Classic TIFF addresses the file with 32-bit offsets
+        qint64 offset = m_device.pos();
+        if (offset + strip.size() > qint64(UINT32_MAX) - DIRECTORY_RESERVE) {
+            m_error = "TIFF-файл не может быть больше 4 ГиБ.";
+            return false;
+        }
+
+        m_offsets.push_back(uint32_t(offset));
+        m_counts.push_back(uint32_t(strip.size()));
+
+        return write(strip);
+    }
+
+    bool finish() override {
+        enum Type : uint16_t { SHORT = 3, LONG = 4 };
+        constexpr int ENTRIES = 11;
+
+        // Word-aligned directory, followed by the values that don't fit into its entries
+        QByteArray padding(m_device.pos() % 2, '\0');
+        uint32_t directory = uint32_t(m_device.pos() + padding.size());
+        uint32_t extra = directory + 2 + ENTRIES * 12 + 4;
+
+        QByteArray values;
+        auto entry = [&](QByteArray& data, uint16_t tag, Type type, const std::vector<uint32_t>& items) {
+            appendLittleEndian16(data, tag);
+            appendLittleEndian16(data, type);
+            appendLittleEndian32(data, uint32_t(items.size()));
+
+            int size = type == SHORT ? 2 : 4;
+            QByteArray packed;
+            for (uint32_t item : items) {
+                if (type == SHORT) appendLittleEndian16(packed, uint16_t(item));
+                else appendLittleEndian32(packed, item);
+            }
+
+            if (qsizetype(items.size()) * size <= 4) {
+                data.append(packed.leftJustified(4, '\0'));
+            } else {
+                appendLittleEndian32(data, extra + uint32_t(values.size()));
+                values.append(packed);
+            }
+        };
+
+        QByteArray ifd;
+        appendLittleEndian16(ifd, ENTRIES);
+        entry(ifd, 256, LONG, { uint32_t(m_size.width()) });  // ImageWidth
+        entry(ifd, 257, LONG, { uint32_t(m_size.height()) }); // ImageLength
+        entry(ifd, 258, SHORT, { 8, 8, 8, 8 });               // BitsPerSample
+        entry(ifd, 259, SHORT, { 1 });                        // Compression: none
+        entry(ifd, 262, SHORT, { 2 });                        // PhotometricInterpretation: RGB
+        entry(ifd, 273, LONG, m_offsets);                     // StripOffsets
+        entry(ifd, 277, SHORT, { 4 });                        // SamplesPerPixel
+        entry(ifd, 278, LONG, { uint32_t(m_stripHeight) });   // RowsPerStrip
+        entry(ifd, 279, LONG, m_counts);                      // StripByteCounts
+        entry(ifd, 284, SHORT, { 1 });                        // PlanarConfiguration: interleaved
+        entry(ifd, 338, SHORT, { 2 });                        // ExtraSamples: unassociated alpha
+        appendLittleEndian32(ifd, 0);                         // No next directory
+
+        if (!write(padding) || !write(ifd) || !write(values)) return false;
+
+        QByteArray offset;
+        appendLittleEndian32(offset, directory);
+        return m_device.seek(4) && write(offset);
+    }
+
+private:
+    // Room left for the directory and its strip tables
+    static constexpr qint64 DIRECTORY_RESERVE = 16 * 1024 * 1024;
+
+    QSize m_size;
+    int m_stripHeight = 0;
+    std::vector<uint32_t> m_offsets;
+    std::vector<uint32_t> m_counts;
+};
+
+std::unique_ptr<BandWriter> makeWriter(StreamingScaler::OutputFormat format, QIODevice& device) {
+    switch (format) {
+    case StreamingScaler::OutputFormat::Png: return std::make_unique<PngWriter>(device);
+    case StreamingScaler::OutputFormat::Tiff: return std::make_unique<TiffWriter>(device);
+    case StreamingScaler::OutputFormat::Raw: break;
+    }
+    return std::make_unique<RawWriter>(device);
+}
+} // namespace
+
+StreamingScaler::OutputFormat StreamingScaler::formatForFile(const QString& fileName) {
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+
+    if (suffix == "png") return OutputFormat::Png;
+    if (suffix == "tif" || suffix == "tiff") return OutputFormat::Tiff;
+    return OutputFormat::Raw;
+}
+
+bool StreamingScaler::scaleFile(const QString& sourcePath, const QString& targetPath, const Options& options,
+                                QString* error) {
+    auto fail = [&](const QString& message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    QImageReader probe(sourcePath);
+    QSize sourceSize = probe.size();
+    if (!sourceSize.isValid()) {
+        return fail(QString("Не удалось прочитать %1: %2").arg(sourcePath, probe.errorString()));
+    }
+
+    QSize size(std::roundf(sourceSize.width() * options.scale), std::roundf(sourceSize.height() * options.scale));
+    if (size.width() <= 0 || size.height() <= 0) {
+        return fail("Слишком маленький коэффициент масштабирования.");
+    }
+
+    int stripHeight = std::max(options.stripHeight, 1);
+
+    // Source rows that fit into the budget once decoded, at 4 bytes per pixel
+    qint64 rowBytes = qint64(sourceSize.width()) * 4;
+    int budgetRows = int(std::min<qint64>(options.sourceBudget / rowBytes, sourceSize.height()));
+
+    // Without ClipRect the plugin can only decode the whole image, which is allowed only if it fits
+    bool clipping = probe.supportsOption(QImageIOHandler::ClipRect);
+    if (!clipping && budgetRows < sourceSize.height()) {
+        return fail(QString("Формат %1 не читается по частям, а изображение целиком не помещается в %2 МиБ.")
+                        .arg(QString::fromLatin1(probe.format()))
+                        .arg(options.sourceBudget / (1024 * 1024)));
+    }
+
+    // Nothing replaces the target until every band has been written
+    QSaveFile file(targetPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return fail(QString("Не удалось открыть %1: %2").arg(targetPath, file.errorString()));
+    }
+
+    std::unique_ptr<BandWriter> writer = makeWriter(options.format, file);
+    if (!writer->begin(size, stripHeight)) return fail(writer->errorString());
+
+    // Decoded source rows [stripTop; stripTop + strip.height())
+    QImage strip;
+    int stripTop = 0;
+
+    for (int yBegin = 0; yBegin < size.height(); yBegin += stripHeight) {
+        int yEnd = std::min(yBegin + stripHeight, size.height());
+        auto [first, last] = ImageProcessor::bandSourceRows(options.method, sourceSize.height(), size.height(), yBegin, yEnd);
+
+        if (strip.isNull() || first < stripTop || last > stripTop + strip.height()) {
+            if (last - first > budgetRows) {
+                return fail("Полоса не помещается в бюджет памяти, уменьшите высоту полосы.");
+            }
+
+            // Bands only move down, so the strip starts at the band and reads as far ahead as allowed
+            QImageReader reader(sourcePath);
+            if (clipping) {
+                stripTop = first;
+                reader.setClipRect(QRect(0, first, sourceSize.width(), std::min(budgetRows, sourceSize.height() - first)));
+            }
+
+            strip = reader.read();
+            if (strip.isNull()) {
+                return fail(QString("Не удалось прочитать %1: %2").arg(sourcePath, reader.errorString()));
+            }
+        }
+
+        QImage band = ImageProcessor::applyBandScaling(options.method, strip, stripTop, sourceSize.height(),
+                                                       size, yBegin, yEnd);
+        if (!writer->writeBand(band)) return fail(writer->errorString());
+
+        if (options.progress && !options.progress(yEnd, size.height())) return fail("Масштабирование отменено.");
+    }
+
+    if (!writer->finish()) return fail(writer->errorString());
+    if (!file.commit()) return fail(file.errorString());
+
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef STREAMINGSCALER_H
+#define STREAMINGSCALER_H
+
+#include <QString>
+
+#include <functional>
+
+#include "imageprocessor.h"
+
+// Scales image files too large for memory. The result is produced band by band: each band is
+// scaled with ImageProcessor::applyBandScaling from a strip of decoded source rows and appended
+// to the target file before the next band starts. A strip is as tall as sourceBudget allows and
+// serves every band inside it, so the source is decoded in few large pieces rather than once
+// per band. Memory use is bounded by one destination band and one source strip.
+class StreamingScaler
+{
+public:
+    // Layout of the target file
+    enum class OutputFormat {
+        Png,  // RGBA, uncompressed (stored) deflate blocks, one IDAT chunk per band
+        Tiff, // Baseline uncompressed RGBA, one strip per band, up to 4 GiB
+        Raw   // Headerless rows of QImage::Format_ARGB32 pixels
+    };
+
+    struct Options {
+        float scale = 1.0f;
+        ImageProcessor::ScalingMethod method = ImageProcessor::ScalingMethod::Bilinear;
+        OutputFormat format = OutputFormat::Png;
+        int stripHeight = 256; // Destination rows per band
+        qint64 sourceBudget = qint64(256) * 1024 * 1024; // Bytes of decoded source rows held at once
+        // Called after every band with the destination rows written so far, returning false cancels
+        std::function<bool(int rowsDone, int rowsTotal)> progress;
+    };
+
+    // Scale the image at sourcePath into targetPath. Returns false and describes the problem
+    // in error (if given) when the source can't be read within sourceBudget, the target can't
+    // be written or progress cancels. The target is left untouched then.
+    static bool scaleFile(const QString& sourcePath, const QString& targetPath, const Options& options,
+                          QString* error = nullptr);
+
+    // Format matching the suffix of a file name (.png, .tif/.tiff, anything else is raw)
+    static OutputFormat formatForFile(const QString& fileName);
+};
+
+#endif // STREAMINGSCALER_H